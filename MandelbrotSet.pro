@@ -3,7 +3,6 @@
 # Project created by QtCreator 2014-12-31T18:59:45
 #
 #-------------------------------------------------
-CONFIG += c++11
 QT       += core gui
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
@@ -11,15 +10,11 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = MandelbrotSet
 TEMPLATE = app
 
-QMAKE_CXXFLAGS_RELEASE -= -O2
-QMAKE_CXXFLAGS_RELEASE *= -Ofast
+include(engine.pri)
 
 SOURCES += main.cpp\
-        mandelbrotmainwindow.cpp \
-        mandelbrotset.cpp
+        mandelbrotmainwindow.cpp
 
-HEADERS  += mandelbrotmainwindow.h \
-            mandelbrotset.h \
-            MathParser/mathparser.h
+HEADERS  += mandelbrotmainwindow.h
 
 FORMS    += mandelbrotmainwindow.ui
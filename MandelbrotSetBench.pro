@@ -0,0 +1,16 @@
+#-------------------------------------------------
+#
+# Benchmark of the engine on fixed scenes, no widgets
+#
+#-------------------------------------------------
+#gui is needed for QImage only
+QT       += core gui
+
+TARGET = mandelbrotbench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(engine.pri)
+
+SOURCES += benchmain.cpp
@@ -0,0 +1,16 @@
+#-------------------------------------------------
+#
+# Headless command line renderer, no widgets
+#
+#-------------------------------------------------
+#gui is needed for QImage only
+QT       += core gui
+
+TARGET = mandelbrotcli
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(engine.pri)
+
+SOURCES += climain.cpp
@@ -0,0 +1,259 @@
+#include "batcheval.h"
+#include <QByteArray>
+#include <cmath>
+#include <cstdlib>
+
+//recursive descent compiler, operator precedence as in MathParser:
+//expression: term (('+'|'-') term)*
+//term:       unary (('*'|'/') unary)*
+//unary:      ('+'|'-') unary | power
+//power:      primary ('^' integer)?
+//primary:    number | variable | function '(' expression [',' expression] ')' | '(' expression ')'
+//formulas whose meaning could depend on details of MathParser aren't compiled and are left to the interpreter:
+//exponents other than an unsigned integer, and a minus sign directly in front of a power, as in -z^3.
+class BatchCompiler
+{
+public:
+    BatchCompiler(const QByteArray& str,BatchProgram& program): str_(str), pos_(0), program_(program), z_(-1), c_(-1), power_(false) {}
+    bool compile()
+    {
+        program_.instructions_.clear();
+        program_.variables_.clear();
+        qint32 r;
+        if(!parseExpression(r) || pos_!=str_.size())
+            return false;
+        program_.result_=r;
+        return true;
+    }
+private:
+    qint32 add(BatchInstruction::OpCode op,qint32 a=0,qint32 b=0,qint32 n=0,double re=0.,double im=0.)
+    {
+        BatchInstruction in={op,a,b,n,re,im};
+        program_.instructions_.push_back(in);
+        return (qint32)program_.instructions_.size()-1;
+    }
+    const BatchInstruction& at(qint32 r) const {return program_.instructions_[r];}
+    bool isConst(qint32 r) const {return at(r).op==BatchInstruction::CONST;}
+    //binary operation, folded into a constant if both operands are constant
+    qint32 addBinary(BatchInstruction::OpCode op,qint32 a,qint32 b)
+    {
+        if(isConst(a) && isConst(b))
+        {
+            std::complex<double> x(at(a).re,at(a).im),y(at(b).re,at(b).im),w;
+            switch(op)
+            {
+            case BatchInstruction::ADD: w=x+y; break;
+            case BatchInstruction::SUB: w=x-y; break;
+            case BatchInstruction::MUL: w=x*y; break;
+            case BatchInstruction::DIV: w=x/y; break;
+            default: return add(op,a,b);
+            }
+            return add(BatchInstruction::CONST,0,0,0,w.real(),w.imag());
+        }
+        return add(op,a,b);
+    }
+    void skipSpace()
+    {
+        while(pos_<str_.size() && (str_.at(pos_)==' ' || str_.at(pos_)=='\t'))
+            ++pos_;
+    }
+    bool accept(char ch)
+    {
+        skipSpace();
+        if(pos_<str_.size() && str_.at(pos_)==ch)
+        {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+    static bool isDigit(char ch) {return ch>='0' && ch<='9';}
+    static bool isLetter(char ch) {return (ch>='a' && ch<='z') || (ch>='A' && ch<='Z');}
+    bool parseExpression(qint32& r)
+    {
+        if(!parseTerm(r))
+            return false;
+        for(;;)
+        {
+            qint32 b;
+            if(accept('+'))
+            {
+                if(!parseTerm(b))
+                    return false;
+                r=addBinary(BatchInstruction::ADD,r,b);
+            }
+            else if(accept('-'))
+            {
+                if(!parseTerm(b))
+                    return false;
+                r=addBinary(BatchInstruction::SUB,r,b);
+            }
+            else
+                return true;
+        }
+    }
+    bool parseTerm(qint32& r)
+    {
+        if(!parseUnary(r))
+            return false;
+        for(;;)
+        {
+            qint32 b;
+            if(accept('*'))
+            {
+                if(!parseUnary(b))
+                    return false;
+                r=addBinary(BatchInstruction::MUL,r,b);
+            }
+            else if(accept('/'))
+            {
+                if(!parseUnary(b))
+                    return false;
+                r=addBinary(BatchInstruction::DIV,r,b);
+            }
+            else
+                return true;
+        }
+    }
+    bool parseUnary(qint32& r)
+    {
+        if(accept('+'))
+            return parseUnary(r);
+        if(accept('-'))
+        {
+            if(!parseUnary(r) || power_)
+                return false;
+            if(isConst(r))
+                r=add(BatchInstruction::CONST,0,0,0,-at(r).re,-at(r).im);
+            else
+                r=add(BatchInstruction::NEG,r);
+            return true;
+        }
+        return parsePower(r);
+    }
+    //power_ tells parseUnary whether the operand it just parsed was a power
+    bool parsePower(qint32& r)
+    {
+        if(!parsePrimary(r))
+            return false;
+        power_=accept('^');
+        if(!power_)
+            return true;
+        skipSpace();
+        qint32 e;
+        if(pos_>=str_.size() || !isDigit(str_.at(pos_)) || !parseNumber(e))
+            return false;
+        //integer exponents are unrolled into multiplications
+        if(at(e).re!=std::floor(at(e).re) || at(e).re>1024.)
+            return false;
+        r=add(BatchInstruction::POWI,r,0,(qint32)at(e).re);
+        return true;
+    }
+    bool parseNumber(qint32& r)
+    {
+        qint32 start=pos_;
+        while(pos_<str_.size() && isDigit(str_.at(pos_)))
+            ++pos_;
+        if(pos_<str_.size() && str_.at(pos_)=='.')
+        {
+            ++pos_;
+            while(pos_<str_.size() && isDigit(str_.at(pos_)))
+                ++pos_;
+        }
+        if(pos_<str_.size() && (str_.at(pos_)=='e' || str_.at(pos_)=='E'))
+        {
+            qint32 p=pos_+1;
+            if(p<str_.size() && (str_.at(p)=='+' || str_.at(p)=='-'))
+                ++p;
+            if(p<str_.size() && isDigit(str_.at(p)))
+            {
+                pos_=p;
+                while(pos_<str_.size() && isDigit(str_.at(pos_)))
+                    ++pos_;
+            }
+        }
+        std::string number(str_.constData()+start,pos_-start);
+        r=add(BatchInstruction::CONST,0,0,0,std::strtod(number.c_str(),0),0.);
+        return true;
+    }
+    bool parseFunction(const std::string& name,qint32& r)
+    {
+        static const struct {const char* name; BatchInstruction::OpCode op;} functions[]=
+        {
+            {"sin",BatchInstruction::SIN},{"cos",BatchInstruction::COS},{"tan",BatchInstruction::TAN},
+            {"exp",BatchInstruction::EXP},{"log",BatchInstruction::LOG},{"sqrt",BatchInstruction::SQRT},
+            {"Re",BatchInstruction::RE},{"Im",BatchInstruction::IM},{"pow",BatchInstruction::POW}
+        };
+        for(size_t f=0;f<sizeof(functions)/sizeof(functions[0]);++f)
+        {
+            if(name!=functions[f].name)
+                continue;
+            qint32 a,b=0;
+            if(!parseExpression(a))
+                return false;
+            if(functions[f].op==BatchInstruction::POW && (!accept(',') || !parseExpression(b)))
+                return false;
+            if(!accept(')'))
+                return false;
+            r=add(functions[f].op,a,b);
+            return true;
+        }
+        return false;
+    }
+    bool parsePrimary(qint32& r)
+    {
+        skipSpace();
+        if(pos_>=str_.size())
+            return false;
+        char ch=str_.at(pos_);
+        if(isDigit(ch) || ch=='.')
+            return parseNumber(r);
+        if(accept('('))
+            return parseExpression(r) && accept(')');
+        if(!isLetter(ch))
+            return false;
+        std::string name;
+        while(pos_<str_.size() && isLetter(str_.at(pos_)))
+            name+=str_.at(pos_++);
+        if(accept('('))
+            return parseFunction(name,r);
+        if(name.size()!=1)
+            return false;
+        if(program_.variables_.find(name[0])==std::string::npos)
+            program_.variables_+=name[0];
+        switch(name[0])
+        {
+        case 'z':
+            if(z_<0)
+                z_=add(BatchInstruction::VAR_Z);
+            r=z_;
+            break;
+        case 'c':
+            if(c_<0)
+                c_=add(BatchInstruction::VAR_C);
+            r=c_;
+            break;
+        case 'i':
+            r=add(BatchInstruction::CONST,0,0,0,0.,1.);
+            break;
+        default:
+            //variables without a meaning in iteration formulas evaluate to 0
+            r=add(BatchInstruction::CONST);
+            break;
+        }
+        return true;
+    }
+
+    QByteArray str_;
+    qint32 pos_;
+    BatchProgram& program_;
+    qint32 z_,c_;
+    bool power_;
+};
+
+bool BatchProgram::compile(const QString &formula)
+{
+    BatchCompiler compiler(formula.toLatin1(),*this);
+    valid_=compiler.compile();
+    return valid_;
+}
@@ -0,0 +1,263 @@
+#ifndef BATCHEVAL_H
+#define BATCHEVAL_H
+
+#include <QString>
+#include <complex>
+#include <string>
+#include <vector>
+
+//Lane-wise evaluation of user defined formulas. A formula is compiled once into a list of register operations
+//which are then run over blocks of up to LANES points at a time, each register holding the real and imaginary
+//parts of all lanes in separate arrays. The dispatch cost is paid once per operation and block instead of once
+//per operation and pixel, and the loops over the lanes are simple enough for the compiler to vectorize.
+//The grammar is the one understood by MathParser, see readme.txt.
+
+struct BatchInstruction
+{
+    enum OpCode {CONST,VAR_Z,VAR_C,ADD,SUB,MUL,DIV,NEG,POWI,POW,SIN,COS,TAN,EXP,LOG,SQRT,RE,IM};
+    OpCode op;
+    //operand registers
+    qint32 a,b;
+    //exponent of POWI, not negative
+    qint32 n;
+    //value of CONST
+    double re,im;
+};
+
+class BatchProgram
+{
+public:
+    BatchProgram(): result_(0), valid_(false) {}
+    //compiles the formula, returns false if the formula can't be run by the batch evaluator
+    bool compile(const QString& formula);
+    bool isValid() const {return valid_;}
+    //true if the formula refers to the single letter variable name
+    bool usesVariable(char name) const {return variables_.find(name)!=std::string::npos;}
+    const std::vector<BatchInstruction>& instructions() const {return instructions_;}
+    //register holding the result, registers are numbered like the instructions writing them
+    qint32 resultRegister() const {return result_;}
+private:
+    friend class BatchCompiler;
+    std::vector<BatchInstruction> instructions_;
+    qint32 result_;
+    std::string variables_;
+    bool valid_;
+};
+
+//evaluates a compiled program over up to LANES values of z and c, one instance per thread
+template<typename T> class BatchEval
+{
+public:
+    static const qint32 LANES=64;
+    BatchEval(): program_(0) {}
+    void setProgram(const BatchProgram* program);
+    //evaluates the formula for count<=LANES lanes, the results are available through resultRe and resultIm
+    void run(const T* zr,const T* zi,const T* cr,const T* ci,qint32 count);
+    const T* resultRe() const {return re_.data()+program_->resultRegister()*LANES;}
+    const T* resultIm() const {return im_.data()+program_->resultRegister()*LANES;}
+private:
+    const BatchProgram* program_;
+    //register r of lane k is stored at index r*LANES+k
+    std::vector<T> re_,im_;
+};
+
+template<typename T> void BatchEval<T>::setProgram(const BatchProgram *program)
+{
+    program_=program;
+    const std::vector<BatchInstruction>& ins=program->instructions();
+    re_.assign(ins.size()*LANES,T(0));
+    im_.assign(ins.size()*LANES,T(0));
+    //constants are filled in once
+    for(size_t r=0;r<ins.size();++r)
+        if(ins[r].op==BatchInstruction::CONST)
+            for(qint32 k=0;k<LANES;++k)
+            {
+                re_[r*LANES+k]=(T)ins[r].re;
+                im_[r*LANES+k]=(T)ins[r].im;
+            }
+}
+
+template<typename T> void BatchEval<T>::run(const T *zr, const T *zi, const T *cr, const T *ci, qint32 count)
+{
+    const std::vector<BatchInstruction>& ins=program_->instructions();
+    for(size_t r=0;r<ins.size();++r)
+    {
+        const BatchInstruction& in=ins[r];
+        T* dr=re_.data()+r*LANES;
+        T* di=im_.data()+r*LANES;
+        const T* ar=re_.data()+in.a*LANES;
+        const T* ai=im_.data()+in.a*LANES;
+        const T* br=re_.data()+in.b*LANES;
+        const T* bi=im_.data()+in.b*LANES;
+        switch(in.op)
+        {
+        case BatchInstruction::CONST:
+            break;
+        case BatchInstruction::VAR_Z:
+            for(qint32 k=0;k<count;++k)
+            {
+                dr[k]=zr[k];
+                di[k]=zi[k];
+            }
+            break;
+        case BatchInstruction::VAR_C:
+            for(qint32 k=0;k<count;++k)
+            {
+                dr[k]=cr[k];
+                di[k]=ci[k];
+            }
+            break;
+        case BatchInstruction::ADD:
+            for(qint32 k=0;k<count;++k)
+            {
+                dr[k]=ar[k]+br[k];
+                di[k]=ai[k]+bi[k];
+            }
+            break;
+        case BatchInstruction::SUB:
+            for(qint32 k=0;k<count;++k)
+            {
+                dr[k]=ar[k]-br[k];
+                di[k]=ai[k]-bi[k];
+            }
+            break;
+        case BatchInstruction::MUL:
+            for(qint32 k=0;k<count;++k)
+            {
+                T re=ar[k]*br[k]-ai[k]*bi[k];
+                T im=ar[k]*bi[k]+ai[k]*br[k];
+                dr[k]=re;
+                di[k]=im;
+            }
+            break;
+        case BatchInstruction::DIV:
+            for(qint32 k=0;k<count;++k)
+            {
+                T d=br[k]*br[k]+bi[k]*bi[k];
+                T re=(ar[k]*br[k]+ai[k]*bi[k])/d;
+                T im=(ai[k]*br[k]-ar[k]*bi[k])/d;
+                dr[k]=re;
+                di[k]=im;
+            }
+            break;
+        case BatchInstruction::NEG:
+            for(qint32 k=0;k<count;++k)
+            {
+                dr[k]=-ar[k];
+                di[k]=-ai[k];
+            }
+            break;
+        case BatchInstruction::POWI:
+        {
+            //binary exponentiation, the same bit pattern for all lanes
+            qint32 e=in.n;
+            T baseRe[LANES],baseIm[LANES];
+            for(qint32 k=0;k<count;++k)
+            {
+                baseRe[k]=ar[k];
+                baseIm[k]=ai[k];
+                dr[k]=T(1);
+                di[k]=T(0);
+            }
+            while(e)
+            {
+                if(e&1)
+                    for(qint32 k=0;k<count;++k)
+                    {
+                        T re=dr[k]*baseRe[k]-di[k]*baseIm[k];
+                        T im=dr[k]*baseIm[k]+di[k]*baseRe[k];
+                        dr[k]=re;
+                        di[k]=im;
+                    }
+                e>>=1;
+                if(e)
+                    for(qint32 k=0;k<count;++k)
+                    {
+                        T re=baseRe[k]*baseRe[k]-baseIm[k]*baseIm[k];
+                        T im=T(2)*baseRe[k]*baseIm[k];
+                        baseRe[k]=re;
+                        baseIm[k]=im;
+                    }
+            }
+            break;
+        }
+        case BatchInstruction::POW:
+            for(qint32 k=0;k<count;++k)
+            {
+                std::complex<T> w=std::pow(std::complex<T>(ar[k],ai[k]),std::complex<T>(br[k],bi[k]));
+                dr[k]=w.real();
+                di[k]=w.imag();
+            }
+            break;
+        case BatchInstruction::SIN:
+            for(qint32 k=0;k<count;++k)
+            {
+                T re=std::sin(ar[k])*std::cosh(ai[k]);
+                T im=std::cos(ar[k])*std::sinh(ai[k]);
+                dr[k]=re;
+                di[k]=im;
+            }
+            break;
+        case BatchInstruction::COS:
+            for(qint32 k=0;k<count;++k)
+            {
+                T re=std::cos(ar[k])*std::cosh(ai[k]);
+                T im=-std::sin(ar[k])*std::sinh(ai[k]);
+                dr[k]=re;
+                di[k]=im;
+            }
+            break;
+        case BatchInstruction::TAN:
+            for(qint32 k=0;k<count;++k)
+            {
+                std::complex<T> w=std::tan(std::complex<T>(ar[k],ai[k]));
+                dr[k]=w.real();
+                di[k]=w.imag();
+            }
+            break;
+        case BatchInstruction::EXP:
+            for(qint32 k=0;k<count;++k)
+            {
+                T m=std::exp(ar[k]);
+                T re=m*std::cos(ai[k]);
+                T im=m*std::sin(ai[k]);
+                dr[k]=re;
+                di[k]=im;
+            }
+            break;
+        case BatchInstruction::LOG:
+            for(qint32 k=0;k<count;++k)
+            {
+                T re=T(0.5)*std::log(ar[k]*ar[k]+ai[k]*ai[k]);
+                T im=std::atan2(ai[k],ar[k]);
+                dr[k]=re;
+                di[k]=im;
+            }
+            break;
+        case BatchInstruction::SQRT:
+            for(qint32 k=0;k<count;++k)
+            {
+                std::complex<T> w=std::sqrt(std::complex<T>(ar[k],ai[k]));
+                dr[k]=w.real();
+                di[k]=w.imag();
+            }
+            break;
+        case BatchInstruction::RE:
+            for(qint32 k=0;k<count;++k)
+            {
+                dr[k]=ar[k];
+                di[k]=T(0);
+            }
+            break;
+        case BatchInstruction::IM:
+            for(qint32 k=0;k<count;++k)
+            {
+                dr[k]=ai[k];
+                di[k]=T(0);
+            }
+            break;
+        }
+    }
+}
+
+#endif // BATCHEVAL_H
@@ -0,0 +1,286 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThread>
+#include "mandelbrotset.h"
+#include "configio.h"
+
+//exit codes, parse errors of a scene are reported with the bits of MandelbrotSet::ErrorCodes
+enum ExitCodes {EXIT_USAGE_ERROR=8,EXIT_WRITE_ERROR=16};
+
+//configurations of the configuration file every run includes
+static const char* const CONFIG_FILE_SCENES[]={"Set001","Set002","Set003","Set004"};
+
+struct Scene
+{
+    QString name;
+    MandelbrotConfig config;
+    QImage colorPalette;
+};
+
+struct Measurement
+{
+    double seconds;
+    qint64 iterations;
+    QString precision;
+    qint32 errorCode;
+};
+
+//thread counts as "1,2,4", by default doubling up to the ideal thread count, which is always included
+static bool parseThreadCounts(const QString& str,std::vector<qint32>& counts)
+{
+    counts.clear();
+    if(str.isEmpty())
+    {
+        qint32 ideal=QThread::idealThreadCount();
+        for(qint32 n=1;n<ideal;n*=2)
+            counts.push_back(n);
+        counts.push_back(ideal);
+        return true;
+    }
+    QStringList parts=str.split(',');
+    for(qint32 i=0;i<parts.size();++i)
+    {
+        bool ok;
+        qint32 n=parts[i].toInt(&ok);
+        if(!ok || n<1)
+            return false;
+        counts.push_back(n);
+    }
+    return true;
+}
+
+//palettes are looked up in the working directory first, then next to the configuration file
+static QImage loadPalette(const QString& fileName,const QString& configFileName)
+{
+    QImage colorPalette;
+    if(fileName!="" && !colorPalette.load(fileName))
+        colorPalette.load(QFileInfo(configFileName).dir().filePath(fileName));
+    if(colorPalette.isNull())
+        colorPalette=defaultColorPalette();
+    return colorPalette;
+}
+
+//renders on a thread of its own, so the main thread can cancel it
+class RenderThread : public QThread
+{
+public:
+    RenderThread(MandelbrotSet& engine,const RenderRequest& request): engine_(engine), request_(request) {}
+protected:
+    void run() {engine_.render(request_);}
+private:
+    MandelbrotSet& engine_;
+    RenderRequest request_;
+};
+
+static void setUpEngine(MandelbrotSet& mandelbrotSet,const Scene& scene,qint32 threads)
+{
+    const MandelbrotConfig& config=scene.config;
+    mandelbrotSet.setThreadCount(threads);
+    mandelbrotSet.setTileCacheBudget(0);
+    mandelbrotSet.setColorPalette(scene.colorPalette);
+    mandelbrotSet.parseFormula(config.formula);
+    mandelbrotSet.parsePaletteXFormula(config.paletteFormulaX);
+    mandelbrotSet.parsePaletteYFormula(config.paletteFormulaY);
+    mandelbrotSet.setCol0Interior(config.col0interior);
+    mandelbrotSet.setRow0Interior(config.row0interior);
+}
+
+static RenderRequest sceneRequest(const Scene& scene,qint32 width,qint32 height,qint32 generation)
+{
+    const MandelbrotConfig& config=scene.config;
+    RenderRequest request={config.centerX,config.centerY,width,height,config.scale,config.nIterations,config.limit,1,config.julia,config.juliaRe,config.juliaIm,false,generation};
+    return request;
+}
+
+//renders a scene once with a fresh engine, so neither the iteration buffer nor the tile cache carry over between runs
+static Measurement measure(const Scene& scene,qint32 width,qint32 height,qint32 threads)
+{
+    Measurement result={0.,0,"",0};
+    MandelbrotSet mandelbrotSet;
+    QObject::connect(&mandelbrotSet,&MandelbrotSet::errorCodeOut,[&result](qint32 code){result.errorCode=code;});
+    QObject::connect(&mandelbrotSet,&MandelbrotSet::precisionOut,[&result](QString precision){result.precision=precision;});
+    QObject::connect(&mandelbrotSet,&MandelbrotSet::statsOut,[&result](RenderStats stats){result.iterations+=stats.iterations;});
+    setUpEngine(mandelbrotSet,scene,threads);
+    QElapsedTimer timer;
+    timer.start();
+    mandelbrotSet.render(sceneRequest(scene,width,height,mandelbrotSet.generation()));
+    result.seconds=timer.nsecsElapsed()*1e-9;
+    return result;
+}
+
+//milliseconds from cancelling a render of the scene after the given time until the engine returns
+static double cancelLatency(const Scene& scene,qint32 width,qint32 height,qint32 threads,double delaySeconds)
+{
+    MandelbrotSet mandelbrotSet;
+    setUpEngine(mandelbrotSet,scene,threads);
+    RenderThread thread(mandelbrotSet,sceneRequest(scene,width,height,mandelbrotSet.generation()));
+    thread.start();
+    QThread::usleep((unsigned long)(delaySeconds*1e6));
+    QElapsedTimer timer;
+    timer.start();
+    mandelbrotSet.cancel();
+    thread.wait();
+    return timer.nsecsElapsed()*1e-6;
+}
+
+int main(qint32 argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("mandelbrotbench");
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders a fixed set of scenes at several thread counts and reports the timings as JSON.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("output","JSON file to write, standard output if omitted.","[output]");
+    QCommandLineOption configFileOption("config","Configuration file holding the scenes Set001 to Set004.","file","config.cfg");
+    QCommandLineOption widthOption(QStringList()<<"W"<<"width","Image width in pixels.","pixels","1024");
+    QCommandLineOption heightOption(QStringList()<<"H"<<"height","Image height in pixels.","pixels","768");
+    QCommandLineOption threadsOption(QStringList()<<"j"<<"threads","Comma separated thread counts, by default powers of 2 up to the number of cores.","n,...");
+    QCommandLineOption repeatOption(QStringList()<<"r"<<"repeat","Renders per scene and thread count, the fastest one is reported.","n","3");
+    parser.addOption(configFileOption);
+    parser.addOption(widthOption);
+    parser.addOption(heightOption);
+    parser.addOption(threadsOption);
+    parser.addOption(repeatOption);
+    parser.process(a);
+
+    bool ok=parser.positionalArguments().size()<=1;
+    qint32 width=0,height=0,repeat=0;
+    std::vector<qint32> threadCounts;
+    if(ok)
+        width=parser.value(widthOption).toInt(&ok);
+    if(ok)
+        height=parser.value(heightOption).toInt(&ok);
+    if(ok)
+        repeat=parser.value(repeatOption).toInt(&ok);
+    if(ok)
+        ok=parseThreadCounts(parser.value(threadsOption),threadCounts);
+    if(!ok || width<1 || height<1 || repeat<1)
+    {
+        err<<"Invalid parameter.\n";
+        return EXIT_USAGE_ERROR;
+    }
+
+    //scenes: the default configurations, the sample configurations of the configuration file, a formula without
+    //a compiled kernel and a view inside the period 3 bulb where every pixel runs to the iteration limit
+    QString configFileName=parser.value(configFileOption);
+    ConfigList configs;
+    if(!readConfigFile(configFileName,configs))
+    {
+        err<<"Can't read configuration file "<<configFileName<<".\n";
+        return EXIT_USAGE_ERROR;
+    }
+    std::vector<Scene> scenes;
+    Scene defaultScene={DEFAULT_CONFIG_NAME,DEFAULT_CONFIG,QImage()};
+    scenes.push_back(defaultScene);
+    Scene smoothScene={DEFAULT_CONFIG_SMOOTH_COLORING_NAME,DEFAULT_CONFIG_SMOOTH_COLORING,QImage()};
+    scenes.push_back(smoothScene);
+    for(size_t i=0;i<sizeof(CONFIG_FILE_SCENES)/sizeof(CONFIG_FILE_SCENES[0]);++i)
+    {
+        size_t index=0;
+        while(index<configs.size() && configs[index].first!=CONFIG_FILE_SCENES[i])
+            ++index;
+        if(index==configs.size())
+        {
+            err<<"Unknown configuration "<<CONFIG_FILE_SCENES[i]<<".\n";
+            return EXIT_USAGE_ERROR;
+        }
+        Scene scene={configs[index].first,configs[index].second,QImage()};
+        scenes.push_back(scene);
+    }
+    Scene customScene={"Custom function",DEFAULT_CONFIG,QImage()};
+    customScene.config.formula="exp(z)+c";
+    customScene.config.limit=50.;
+    customScene.config.centerX=BigFixed(0.);
+    customScene.config.centerY=BigFixed(0.);
+    customScene.config.scale=8./width;
+    customScene.config.nIterations=200;
+    scenes.push_back(customScene);
+    Scene interiorScene={"Deep interior",DEFAULT_CONFIG,QImage()};
+    interiorScene.config.centerX=BigFixed(-0.1225611669);
+    interiorScene.config.centerY=BigFixed(0.7448617666);
+    interiorScene.config.scale=0.02/width;
+    interiorScene.config.nIterations=20000;
+    scenes.push_back(interiorScene);
+    for(size_t i=0;i<scenes.size();++i)
+        scenes[i].colorPalette=loadPalette(scenes[i].config.colorPaletteFileName,configFileName);
+
+    QJsonArray sceneResults;
+    for(size_t i=0;i<scenes.size();++i)
+    {
+        const Scene& scene=scenes[i];
+        QJsonArray runs;
+        QString precision;
+        double baseSeconds=0.,seconds=0.;
+        for(size_t t=0;t<threadCounts.size();++t)
+        {
+            Measurement best={0.,0,"",0};
+            for(qint32 r=0;r<repeat;++r)
+            {
+                Measurement m=measure(scene,width,height,threadCounts[t]);
+                if(m.errorCode)
+                {
+                    err<<"Error parsing the formulas of "<<scene.name<<".\n";
+                    return m.errorCode;
+                }
+                if(r==0 || m.seconds<best.seconds)
+                    best=m;
+            }
+            if(t==0)
+                baseSeconds=best.seconds;
+            precision=best.precision;
+            seconds=best.seconds;
+            QJsonObject run;
+            run["threads"]=threadCounts[t];
+            run["seconds"]=best.seconds;
+            run["megapixelsPerSecond"]=(double)width*height/best.seconds*1e-6;
+            run["iterations"]=(double)best.iterations;
+            run["gigaiterationsPerSecond"]=best.iterations/best.seconds*1e-9;
+            //relative to the first thread count
+            run["speedup"]=baseSeconds/best.seconds;
+            runs.append(run);
+            err<<scene.name<<", "<<threadCounts[t]<<" threads: "<<best.seconds*1000.<<" ms\n";
+        }
+        QJsonObject result;
+        result["name"]=scene.name;
+        result["formula"]=scene.config.formula;
+        result["iterationLimit"]=scene.config.nIterations;
+        result["precision"]=precision;
+        //formulas without a compiled kernel are run by the batch evaluator if it agrees with the interpreter
+        result["batchEvaluator"]=MandelbrotSet::batchMatchesInterpreter(scene.config.formula);
+        result["runs"]=runs;
+        //cancelled halfway through at the last thread count
+        result["cancelLatencyMs"]=cancelLatency(scene,width,height,threadCounts.back(),seconds/2);
+        sceneResults.append(result);
+    }
+    QJsonObject report;
+    report["width"]=width;
+    report["height"]=height;
+    report["repeat"]=repeat;
+    report["idealThreadCount"]=QThread::idealThreadCount();
+    report["scenes"]=sceneResults;
+    QByteArray json=QJsonDocument(report).toJson();
+
+    if(parser.positionalArguments().isEmpty())
+    {
+        QTextStream out(stdout);
+        out<<json;
+        return 0;
+    }
+    QFile file(parser.positionalArguments()[0]);
+    if(!file.open(QIODevice::WriteOnly) || file.write(json)!=json.size())
+    {
+        err<<"Can't write "<<parser.positionalArguments()[0]<<".\n";
+        return EXIT_WRITE_ERROR;
+    }
+    return 0;
+}
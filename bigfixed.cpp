@@ -0,0 +1,333 @@
+#include "bigfixed.h"
+#include <QByteArray>
+#include <cmath>
+
+BigFixed::BigFixed(double d): BigFixed(FloatExp(d))
+{
+}
+
+BigFixed::BigFixed(const FloatExp &f): negative_(f.m<0), limbs_(INT_LIMBS,0)
+{
+    if(f.m==0. || f.m!=f.m)
+    {
+        negative_=false;
+        return;
+    }
+    //magnitudes beyond the integer part saturate to its largest value
+    if(std::isinf(f.m) || f.e>32*INT_LIMBS)
+    {
+        limbs_.assign(INT_LIMBS,~0u);
+        return;
+    }
+    //|f|=mantissa*2^low with an integer mantissa of 53 bits
+    quint64 mantissa=(quint64)std::ldexp(std::fabs(f.m),53);
+    qint32 low=f.e-53;
+    qint32 fractionLimbs=(low<0)?(-low+31)/32:0;
+    fractionLimbs=(fractionLimbs>MAX_EXACT_LIMBS)?MAX_EXACT_LIMBS:fractionLimbs;
+    limbs_.assign(fractionLimbs+INT_LIMBS,0);
+    //position of the lowest mantissa bit within the limbs
+    qint32 shift=low+32*fractionLimbs;
+    if(shift<0)
+    {
+        mantissa=(-shift>=64)?0:(mantissa>>-shift);
+        shift=0;
+    }
+    qint32 index=shift/32,bit=shift%32;
+    quint64 lo=mantissa<<bit;
+    quint64 hi=bit?(mantissa>>(64-bit)):0;
+    quint32 parts[3]={(quint32)lo,(quint32)(lo>>32),(quint32)hi};
+    for(qint32 k=0;k<3 && index+k<(qint32)limbs_.size();++k)
+        limbs_[index+k]=parts[k];
+    normalizeSign();
+}
+
+BigFixed BigFixed::fromString(const QString &str, bool *ok)
+{
+    QByteArray s=str.trimmed().toLatin1();
+    qint32 pos=0,size=s.size();
+    bool negative=false;
+    if(pos<size && (s.at(pos)=='-' || s.at(pos)=='+'))
+        negative=(s.at(pos++)=='-');
+    QByteArray digits;
+    qint32 pointPos=-1;
+    for(;pos<size;++pos)
+    {
+        char ch=s.at(pos);
+        if(ch>='0' && ch<='9')
+            digits.append(ch);
+        else if(ch=='.' && pointPos<0)
+            pointPos=digits.size();
+        else
+            break;
+    }
+    if(pointPos<0)
+        pointPos=digits.size();
+    bool valid=digits.size()>0;
+    if(valid && pos<size && (s.at(pos)=='e' || s.at(pos)=='E'))
+    {
+        ++pos;
+        bool expNegative=false;
+        if(pos<size && (s.at(pos)=='-' || s.at(pos)=='+'))
+            expNegative=(s.at(pos++)=='-');
+        qint32 exponent=0,start=pos;
+        while(pos<size && s.at(pos)>='0' && s.at(pos)<='9' && exponent<100000)
+            exponent=exponent*10+(s.at(pos++)-'0');
+        valid=(pos>start);
+        pointPos+=expNegative?-exponent:exponent;
+    }
+    valid=valid && pos==size;
+    if(ok)
+        *ok=valid;
+    if(!valid)
+        return BigFixed();
+
+    //the fraction digits decide the precision, 64 guard bits are added
+    qint32 fractionDigits=digits.size()-pointPos;
+    fractionDigits=(fractionDigits<0)?0:fractionDigits;
+    qint32 bits=(qint32)std::ceil(fractionDigits*3.3219280948873623)+64;
+    BigFixed result;
+    result.limbs_.assign((bits+31)/32+INT_LIMBS,0);
+    qint32 fractionLimbs=(qint32)result.limbs_.size()-INT_LIMBS;
+    //fraction by Horner's scheme from the last digit: x=(x+digit)/10, negative positions are leading zeros
+    for(qint32 k=digits.size()-1;k>=pointPos;--k)
+    {
+        result.limbs_[fractionLimbs]+=(k>=0)?(quint32)(digits.at(k)-'0'):0;
+        divideSmall(result.limbs_,10);
+    }
+    //digits in front of the point, padded with zeros for positive exponents
+    for(qint32 k=0;k<pointPos;++k)
+    {
+        Limbs integer(result.limbs_.begin()+fractionLimbs,result.limbs_.end());
+        multiplySmall(integer,10,INT_LIMBS);
+        Limbs digit(INT_LIMBS,0);
+        digit[0]=(k<digits.size())?(quint32)(digits.at(k)-'0'):0;
+        addMagnitude(integer,digit);
+        for(qint32 i=0;i<INT_LIMBS;++i)
+            result.limbs_[fractionLimbs+i]=integer[i];
+    }
+    result.negative_=negative;
+    result.normalizeSign();
+    return result;
+}
+
+QString BigFixed::toString(qint32 decimals) const
+{
+    qint32 fractionLimbs=(qint32)limbs_.size()-INT_LIMBS;
+    quint64 integer=(quint64)limbs_[fractionLimbs]|((quint64)limbs_[fractionLimbs+1]<<32);
+    Limbs fraction(limbs_.begin(),limbs_.begin()+fractionLimbs);
+    QByteArray digits;
+    for(qint32 k=0;k<=decimals;++k)
+        digits.append((char)('0'+(fractionLimbs?multiplySmall(fraction,10,fractionLimbs):0)));
+    //round half up on the extra digit
+    bool carry=digits.at(decimals)>='5';
+    digits.resize(decimals);
+    for(qint32 k=decimals-1;k>=0 && carry;--k)
+    {
+        if(digits.at(k)=='9')
+            digits[k]='0';
+        else
+        {
+            digits[k]=digits.at(k)+1;
+            carry=false;
+        }
+    }
+    if(carry)
+        ++integer;
+    while(digits.size() && digits.at(digits.size()-1)=='0')
+        digits.chop(1);
+    QString result=QString::number(integer);
+    if(digits.size())
+        result+="."+QString::fromLatin1(digits);
+    if(negative_ && result!="0")
+        result="-"+result;
+    return result;
+}
+
+double BigFixed::toDouble() const
+{
+    qint32 fractionLimbs=(qint32)limbs_.size()-INT_LIMBS;
+    double d=0.;
+    //three limbs starting at the most significant nonzero one hold more bits than a double can
+    for(qint32 k=(qint32)limbs_.size()-1;k>=0;--k)
+        if(limbs_[k])
+        {
+            for(qint32 i=k;i>=0 && i>k-3;--i)
+                d+=std::ldexp((double)limbs_[i],32*(i-fractionLimbs));
+            break;
+        }
+    return negative_?-d:d;
+}
+
+FloatExp BigFixed::toFloatExp() const
+{
+    qint32 fractionLimbs=(qint32)limbs_.size()-INT_LIMBS;
+    //like toDouble, with the exponent of the most significant nonzero limb kept apart
+    for(qint32 k=(qint32)limbs_.size()-1;k>=0;--k)
+        if(limbs_[k])
+        {
+            double d=0.;
+            for(qint32 i=k;i>=0 && i>k-3;--i)
+                d+=std::ldexp((double)limbs_[i],32*(i-k));
+            return FloatExp(negative_?-d:d,32*(k-fractionLimbs));
+        }
+    return FloatExp();
+}
+
+BigFixed BigFixed::withPrecision(qint32 bits) const
+{
+    qint32 fractionLimbs=(bits+31)/32;
+    qint32 current=(qint32)limbs_.size()-INT_LIMBS;
+    if(fractionLimbs<=current)
+        return *this;
+    BigFixed result=*this;
+    result.limbs_.insert(result.limbs_.begin(),fractionLimbs-current,0);
+    return result;
+}
+
+BigFixed BigFixed::truncated(qint32 bits) const
+{
+    BigFixed result=*this;
+    qint32 clear=precision()-bits;
+    for(qint32 k=0;k<(qint32)result.limbs_.size() && clear>0;++k,clear-=32)
+        result.limbs_[k]&=(clear>=32)?0u:~((1u<<clear)-1u);
+    result.normalizeSign();
+    return result;
+}
+
+bool BigFixed::isZero() const
+{
+    for(size_t k=0;k<limbs_.size();++k)
+        if(limbs_[k])
+            return false;
+    return true;
+}
+
+BigFixed BigFixed::operator-() const
+{
+    BigFixed result=*this;
+    result.negative_=!negative_;
+    result.normalizeSign();
+    return result;
+}
+
+BigFixed BigFixed::operator+(const BigFixed &other) const
+{
+    qint32 bits=(precision()>other.precision())?precision():other.precision();
+    BigFixed a=withPrecision(bits),b=other.withPrecision(bits);
+    if(a.negative_==b.negative_)
+        addMagnitude(a.limbs_,b.limbs_);
+    else if(compareMagnitude(a.limbs_,b.limbs_)>=0)
+        subtractMagnitude(a.limbs_,b.limbs_);
+    else
+    {
+        subtractMagnitude(b.limbs_,a.limbs_);
+        a=b;
+    }
+    a.normalizeSign();
+    return a;
+}
+
+BigFixed BigFixed::operator-(const BigFixed &other) const
+{
+    return *this+(-other);
+}
+
+BigFixed BigFixed::operator*(const BigFixed &other) const
+{
+    qint32 fa=(qint32)limbs_.size()-INT_LIMBS,fb=(qint32)other.limbs_.size()-INT_LIMBS;
+    qint32 fr=(fa>fb)?fa:fb;
+    //the product has fa+fb fraction limbs, the lowest min(fa,fb) are dropped
+    qint32 drop=(fa<fb)?fa:fb;
+    size_t na=limbs_.size(),nb=other.limbs_.size();
+    Limbs product(na+nb,0);
+    for(size_t i=0;i<na;++i)
+    {
+        if(!limbs_[i])
+            continue;
+        quint64 carry=0;
+        for(size_t j=0;j<nb;++j)
+        {
+            quint64 t=(quint64)product[i+j]+(quint64)limbs_[i]*other.limbs_[j]+carry;
+            product[i+j]=(quint32)t;
+            carry=t>>32;
+        }
+        for(size_t k=i+nb;carry && k<product.size();++k)
+        {
+            quint64 t=(quint64)product[k]+carry;
+            product[k]=(quint32)t;
+            carry=t>>32;
+        }
+    }
+    BigFixed result;
+    result.limbs_.assign(product.begin()+drop,product.begin()+drop+fr+INT_LIMBS);
+    result.negative_=(negative_!=other.negative_);
+    result.normalizeSign();
+    return result;
+}
+
+bool BigFixed::operator==(const BigFixed &other) const
+{
+    qint32 bits=(precision()>other.precision())?precision():other.precision();
+    BigFixed a=withPrecision(bits),b=other.withPrecision(bits);
+    return a.negative_==b.negative_ && a.limbs_==b.limbs_;
+}
+
+qint32 BigFixed::compareMagnitude(const Limbs &a, const Limbs &b)
+{
+    for(qint32 k=(qint32)a.size()-1;k>=0;--k)
+        if(a[k]!=b[k])
+            return (a[k]<b[k])?-1:1;
+    return 0;
+}
+
+void BigFixed::addMagnitude(Limbs &a, const Limbs &b)
+{
+    quint64 carry=0;
+    for(size_t k=0;k<a.size();++k)
+    {
+        quint64 t=(quint64)a[k]+b[k]+carry;
+        a[k]=(quint32)t;
+        carry=t>>32;
+    }
+}
+
+void BigFixed::subtractMagnitude(Limbs &a, const Limbs &b)
+{
+    qint64 borrow=0;
+    for(size_t k=0;k<a.size();++k)
+    {
+        qint64 t=(qint64)a[k]-b[k]-borrow;
+        borrow=(t<0)?1:0;
+        a[k]=(quint32)(t+(borrow<<32));
+    }
+}
+
+//multiplies the lowest limbCount limbs by factor, returns the carry out of them
+quint32 BigFixed::multiplySmall(Limbs &a, quint32 factor, qint32 limbCount)
+{
+    quint64 carry=0;
+    for(qint32 k=0;k<limbCount;++k)
+    {
+        quint64 t=(quint64)a[k]*factor+carry;
+        a[k]=(quint32)t;
+        carry=t>>32;
+    }
+    return (quint32)carry;
+}
+
+void BigFixed::divideSmall(Limbs &a, quint32 divisor)
+{
+    quint64 remainder=0;
+    for(qint32 k=(qint32)a.size()-1;k>=0;--k)
+    {
+        quint64 t=(remainder<<32)|a[k];
+        a[k]=(quint32)(t/divisor);
+        remainder=t%divisor;
+    }
+}
+
+void BigFixed::normalizeSign()
+{
+    if(negative_ && isZero())
+        negative_=false;
+}
@@ -0,0 +1,62 @@
+#ifndef BIGFIXED_H
+#define BIGFIXED_H
+
+#include <QString>
+#include <QMetaType>
+#include "floatexp.h"
+#include <vector>
+
+//Arbitrary precision signed fixed point number with a 64 bit integer part and a variable number of 32 bit fraction
+//limbs. Used for view coordinates and reference orbits at zoom levels beyond double precision, where all values
+//involved stay well within the integer range. Results of binary operations have the precision of the more
+//precise operand, conversions from double, FloatExp and strings pick a precision holding the value exactly.
+
+class BigFixed
+{
+public:
+    BigFixed(): negative_(false), limbs_(INT_LIMBS,0) {}
+    //magnitudes of 2^64 and above saturate to the largest one
+    BigFixed(double d);
+    BigFixed(const FloatExp& f);
+    //parses decimal numbers like -0.123, 1.5e-40
+    static BigFixed fromString(const QString& str,bool* ok=0);
+    //decimal representation rounded to the given number of decimals, trailing zeros are removed
+    QString toString(qint32 decimals) const;
+    double toDouble() const;
+    FloatExp toFloatExp() const;
+    //number of fraction bits
+    qint32 precision() const {return 32*((qint32)limbs_.size()-INT_LIMBS);}
+    //copy with at least the given number of fraction bits
+    BigFixed withPrecision(qint32 bits) const;
+    //copy rounded toward zero to a multiple of 2^-bits, bits may be negative to round off integer bits
+    BigFixed truncated(qint32 bits) const;
+    bool isZero() const;
+
+    BigFixed operator-() const;
+    BigFixed operator+(const BigFixed& other) const;
+    BigFixed operator-(const BigFixed& other) const;
+    BigFixed operator*(const BigFixed& other) const;
+    BigFixed& operator+=(const BigFixed& other) {return *this=*this+other;}
+    BigFixed& operator-=(const BigFixed& other) {return *this=*this-other;}
+    BigFixed& operator*=(const BigFixed& other) {return *this=*this*other;}
+    bool operator==(const BigFixed& other) const;
+    bool operator!=(const BigFixed& other) const {return !(*this==other);}
+private:
+    static const qint32 INT_LIMBS=2;
+    //fraction limbs used for values too small to be held exactly, enough for any scale down to MIN_SCALE
+    static const qint32 MAX_EXACT_LIMBS=320;
+    typedef std::vector<quint32> Limbs;
+    static qint32 compareMagnitude(const Limbs& a,const Limbs& b);
+    static void addMagnitude(Limbs& a,const Limbs& b);
+    static void subtractMagnitude(Limbs& a,const Limbs& b);
+    static quint32 multiplySmall(Limbs& a,quint32 factor,qint32 limbCount);
+    static void divideSmall(Limbs& a,quint32 divisor);
+    void normalizeSign();
+    //magnitude in little endian limbs, the lowest limbs being the fraction
+    bool negative_;
+    Limbs limbs_;
+};
+
+Q_DECLARE_METATYPE(BigFixed)
+
+#endif // BIGFIXED_H
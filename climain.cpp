@@ -0,0 +1,277 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QThread>
+#include "mandelbrotset.h"
+#include "configio.h"
+#include "posterrenderer.h"
+#include "zoomsequence.h"
+#include <QFileInfo>
+#include <cmath>
+
+//exit codes, parse errors are reported with the bits of MandelbrotSet::ErrorCodes
+enum ExitCodes {EXIT_USAGE_ERROR=8,EXIT_WRITE_ERROR=16};
+
+static bool parseJulia(const QString& str,double& re,double& im)
+{
+    //julia parameter as "re,im"
+    QStringList parts=str.split(',');
+    bool okRe=false,okIm=false;
+    if(parts.size()==2)
+    {
+        re=parts[0].toDouble(&okRe);
+        im=parts[1].toDouble(&okIm);
+    }
+    return okRe && okIm;
+}
+
+static void reportErrors(QTextStream& err,qint32 errorCode)
+{
+    if(errorCode&MandelbrotSet::FORMULA_PARSE_ERROR)
+        err<<"Error parsing formula.\n";
+    if(errorCode&MandelbrotSet::PALETTE_XFORMULA_PARSE_ERROR)
+        err<<"Error parsing coloring formula, x-coordinate.\n";
+    if(errorCode&MandelbrotSet::PALETTE_YFORMULA_PARSE_ERROR)
+        err<<"Error parsing coloring formula, y-coordinate.\n";
+}
+
+int main(qint32 argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("mandelbrotcli");
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders a Mandelbrot- or Julia-type set to an image file (PNG, PPM, ... by suffix).");
+    parser.addHelpOption();
+    parser.addPositionalArgument("output","Image file to write.");
+    QCommandLineOption configFileOption("config","Configuration file to load named configurations from.","file","config.cfg");
+    QCommandLineOption nameOption(QStringList()<<"n"<<"name","Named configuration to start from.","name",DEFAULT_CONFIG_NAME);
+    QCommandLineOption formulaOption("formula","Iteration formula.","formula");
+    QCommandLineOption limitOption("limit","Escape limit for |z|^2.","limit");
+    QCommandLineOption xOption("x","Real part of the center.","x");
+    QCommandLineOption yOption("y","Imaginary part of the center.","y");
+    QCommandLineOption scaleOption("scale","Width of a pixel in the complex plane.","scale");
+    QCommandLineOption iterationsOption("iterations","Maximum number of iterations.","n");
+    QCommandLineOption paletteOption("palette","Color palette image.","file");
+    QCommandLineOption paletteXOption("palette-x","Coloring formula, x-coordinate.","formula");
+    QCommandLineOption paletteYOption("palette-y","Coloring formula, y-coordinate.","formula");
+    QCommandLineOption col0Option("col0-interior","Use the first palette column for the interior (0 or 1).","b");
+    QCommandLineOption row0Option("row0-interior","Use the first palette row for the interior (0 or 1).","b");
+    QCommandLineOption juliaOption("julia","Render a Julia-type set for c=re+i*im.","re,im");
+    QCommandLineOption widthOption(QStringList()<<"W"<<"width","Image width in pixels.","pixels","1920");
+    QCommandLineOption heightOption(QStringList()<<"H"<<"height","Image height in pixels.","pixels","1080");
+    QCommandLineOption threadsOption(QStringList()<<"j"<<"threads","Number of render threads.","n",QString::number(QThread::idealThreadCount()));
+    parser.addOption(configFileOption);
+    parser.addOption(nameOption);
+    parser.addOption(formulaOption);
+    parser.addOption(limitOption);
+    parser.addOption(xOption);
+    parser.addOption(yOption);
+    parser.addOption(scaleOption);
+    parser.addOption(iterationsOption);
+    parser.addOption(paletteOption);
+    parser.addOption(paletteXOption);
+    parser.addOption(paletteYOption);
+    parser.addOption(col0Option);
+    parser.addOption(row0Option);
+    parser.addOption(juliaOption);
+    parser.addOption(widthOption);
+    parser.addOption(heightOption);
+    QCommandLineOption posterOption("poster","Render in bands of at most the given megabytes and stream them to a PPM file, "
+                                    "an interrupted poster continues from its checkpoint when run again.","megabytes");
+    QCommandLineOption framesOption("frames","Render a zoom video into the center, written as a numbered PNG sequence output_00000.png, ...","n");
+    QCommandLineOption zoomFactorOption("zoom-factor","Zoom between consecutive frames of a video.","factor","1.02");
+    QCommandLineOption exponentialOption("exponential","Remap the frames of a video from one exponential map of the whole zoom instead of keyframes.");
+    QCommandLineOption antialiasOption("antialias","Add jittered samples up to the given number per pixel where neighboring colors differ.","samples");
+    QCommandLineOption antialiasThresholdOption("antialias-threshold","Color difference to a neighbor at which a pixel gets anti-aliased.",
+                                                "difference",QString::number(MandelbrotSet::DEFAULT_ANTIALIAS_THRESHOLD));
+    QCommandLineOption antialiasBudgetOption("antialias-budget","Extra samples per image as a multiple of its pixels.",
+                                             "budget",QString::number(MandelbrotSet::DEFAULT_ANTIALIAS_BUDGET));
+    parser.addOption(threadsOption);
+    parser.addOption(antialiasOption);
+    parser.addOption(antialiasThresholdOption);
+    parser.addOption(antialiasBudgetOption);
+    parser.addOption(posterOption);
+    parser.addOption(framesOption);
+    parser.addOption(zoomFactorOption);
+    parser.addOption(exponentialOption);
+    parser.process(a);
+
+    if(parser.positionalArguments().size()!=1)
+    {
+        err<<"Expected exactly one output file.\n";
+        return EXIT_USAGE_ERROR;
+    }
+    QString outputFileName=parser.positionalArguments()[0];
+
+    //look the named configuration up among the defaults and the configuration file, later entries don't replace earlier ones just like in the GUI
+    ConfigList configs;
+    configs.push_back(std::make_pair(DEFAULT_CONFIG_NAME,DEFAULT_CONFIG));
+    configs.push_back(std::make_pair(DEFAULT_CONFIG_SMOOTH_COLORING_NAME,DEFAULT_CONFIG_SMOOTH_COLORING));
+    if(!readConfigFile(parser.value(configFileOption),configs) && parser.isSet(configFileOption))
+    {
+        err<<"Can't read configuration file "<<parser.value(configFileOption)<<".\n";
+        return EXIT_USAGE_ERROR;
+    }
+    QString name=parser.value(nameOption);
+    size_t index=0;
+    while(index<configs.size() && configs[index].first!=name)
+        ++index;
+    if(index==configs.size())
+    {
+        err<<"Unknown configuration "<<name<<".\n";
+        return EXIT_USAGE_ERROR;
+    }
+    MandelbrotConfig config=configs[index].second;
+
+    //command line parameters override the configuration
+    bool ok=true;
+    if(parser.isSet(formulaOption))
+        config.formula=parser.value(formulaOption);
+    if(parser.isSet(limitOption))
+        config.limit=parser.value(limitOption).toDouble(&ok);
+    if(ok && parser.isSet(xOption))
+        config.centerX=BigFixed::fromString(parser.value(xOption),&ok);
+    if(ok && parser.isSet(yOption))
+        config.centerY=BigFixed::fromString(parser.value(yOption),&ok);
+    if(ok && parser.isSet(scaleOption))
+        config.scale=FloatExp::fromString(parser.value(scaleOption),&ok);
+    if(ok && parser.isSet(iterationsOption))
+        config.nIterations=parser.value(iterationsOption).toInt(&ok);
+    if(parser.isSet(paletteOption))
+        config.colorPaletteFileName=parser.value(paletteOption);
+    if(parser.isSet(paletteXOption))
+        config.paletteFormulaX=parser.value(paletteXOption);
+    if(parser.isSet(paletteYOption))
+        config.paletteFormulaY=parser.value(paletteYOption);
+    if(ok && parser.isSet(col0Option))
+        config.col0interior=!!parser.value(col0Option).toInt(&ok);
+    if(ok && parser.isSet(row0Option))
+        config.row0interior=!!parser.value(row0Option).toInt(&ok);
+    if(ok && parser.isSet(juliaOption))
+        ok=config.julia=parseJulia(parser.value(juliaOption),config.juliaRe,config.juliaIm);
+    qint32 width=0,height=0,threads=0,posterBudget=0,frames=0,antialiasSamples=1,antialiasThreshold=0;
+    double zoomFactor=0,antialiasBudget=0;
+    if(ok)
+        width=parser.value(widthOption).toInt(&ok);
+    if(ok)
+        height=parser.value(heightOption).toInt(&ok);
+    if(ok)
+        threads=parser.value(threadsOption).toInt(&ok);
+    if(ok && parser.isSet(posterOption))
+    {
+        //posters are always streamed as PPM
+        posterBudget=parser.value(posterOption).toInt(&ok);
+        ok=ok && posterBudget>0 && outputFileName.endsWith(".ppm",Qt::CaseInsensitive);
+    }
+    if(ok && parser.isSet(framesOption))
+    {
+        //frames are always written as PNG
+        frames=parser.value(framesOption).toInt(&ok);
+        if(ok)
+            zoomFactor=parser.value(zoomFactorOption).toDouble(&ok);
+        ok=ok && frames>0 && zoomFactor>1 && !posterBudget && outputFileName.endsWith(".png",Qt::CaseInsensitive);
+    }
+    else if(parser.isSet(exponentialOption))
+        ok=false;
+    if(ok && parser.isSet(antialiasOption))
+    {
+        //only single images are anti-aliased
+        antialiasSamples=parser.value(antialiasOption).toInt(&ok);
+        if(ok)
+            antialiasThreshold=parser.value(antialiasThresholdOption).toInt(&ok);
+        if(ok)
+            antialiasBudget=parser.value(antialiasBudgetOption).toDouble(&ok);
+        ok=ok && antialiasSamples>0 && antialiasThreshold>=0 && antialiasBudget>=0 && !posterBudget && !frames;
+    }
+    if(!ok || width<1 || height<1 || threads<1 || config.nIterations<1 || !(config.scale>0.) ||
+            (frames && ZoomSequence::frameScale(config.scale,zoomFactor,frames-1)<MIN_SCALE))
+    {
+        err<<"Invalid parameter.\n";
+        return EXIT_USAGE_ERROR;
+    }
+
+    QImage colorPalette;
+    if(config.colorPaletteFileName=="" || !colorPalette.load(config.colorPaletteFileName))
+        colorPalette=defaultColorPalette();
+
+    if(posterBudget)
+    {
+        //bands are rendered and written synchronously in this thread
+        PosterRenderer poster;
+        qint32 errorCode=0,result=PosterRenderer::POSTER_COMPLETE;
+        QObject::connect(&poster,&PosterRenderer::errorCodeOut,[&errorCode](qint32 code){errorCode=code;});
+        QObject::connect(&poster,&PosterRenderer::finished,[&result](qint32 code){result=code;});
+        poster.setThreadCount(threads);
+        PosterRequest request={config,colorPalette,width,height,outputFileName,posterBudget};
+        poster.render(request);
+        if(result==PosterRenderer::POSTER_PARSE_ERROR)
+        {
+            reportErrors(err,errorCode);
+            return errorCode;
+        }
+        if(result!=PosterRenderer::POSTER_COMPLETE)
+        {
+            err<<"Can't write "<<outputFileName<<".\n";
+            return EXIT_WRITE_ERROR;
+        }
+        return 0;
+    }
+
+    if(frames)
+    {
+        //keyframes and frames are rendered synchronously in this thread, frames are written by the sequence's own pool
+        ZoomSequence sequence;
+        qint32 errorCode=0,result=ZoomSequence::SEQUENCE_COMPLETE;
+        QObject::connect(&sequence,&ZoomSequence::errorCodeOut,[&errorCode](qint32 code){errorCode=code;});
+        QObject::connect(&sequence,&ZoomSequence::finished,[&result](qint32 code){result=code;});
+        sequence.setThreadCount(threads);
+        sequence.setFramesInFlight(threads);
+        QFileInfo info(outputFileName);
+        QString pattern=info.path()+"/"+info.completeBaseName()+"_%1."+info.suffix();
+        ZoomSequenceRequest request={config,colorPalette,width,height,frames,zoomFactor,pattern,parser.isSet(exponentialOption)};
+        sequence.render(request);
+        if(result==ZoomSequence::SEQUENCE_PARSE_ERROR)
+        {
+            reportErrors(err,errorCode);
+            return errorCode;
+        }
+        if(result!=ZoomSequence::SEQUENCE_COMPLETE)
+        {
+            err<<"Can't write "<<pattern.arg("*")<<".\n";
+            return EXIT_WRITE_ERROR;
+        }
+        return 0;
+    }
+
+    //the engine is driven directly from this thread, render returns once the image is out
+    MandelbrotSet mandelbrotSet;
+    qint32 errorCode=0;
+    QImage image;
+    QObject::connect(&mandelbrotSet,&MandelbrotSet::errorCodeOut,[&errorCode](qint32 code){errorCode=code;});
+    QObject::connect(&mandelbrotSet,&MandelbrotSet::imageOut,[&image](QImage result){image=result;});
+    mandelbrotSet.setThreadCount(threads);
+    mandelbrotSet.setTileCacheBudget(0);
+    mandelbrotSet.parseFormula(config.formula);
+    mandelbrotSet.setColorPalette(colorPalette);
+    mandelbrotSet.parsePaletteXFormula(config.paletteFormulaX);
+    mandelbrotSet.parsePaletteYFormula(config.paletteFormulaY);
+    mandelbrotSet.setCol0Interior(config.col0interior);
+    mandelbrotSet.setRow0Interior(config.row0interior);
+    mandelbrotSet.setAntialiasing(antialiasSamples,antialiasThreshold,antialiasBudget);
+    RenderRequest request={config.centerX,config.centerY,width,height,config.scale,config.nIterations,config.limit,1,config.julia,config.juliaRe,config.juliaIm,false,mandelbrotSet.generation()};
+    mandelbrotSet.render(request);
+
+    if(errorCode)
+    {
+        reportErrors(err,errorCode);
+        return errorCode;
+    }
+    if(image.isNull() || !image.save(outputFileName))
+    {
+        err<<"Can't write "<<outputFileName<<".\n";
+        return EXIT_WRITE_ERROR;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "configio.h"
+#include "precision.h"
+#include <QFile>
+#include <QTextStream>
+#include <QColor>
+#include <cmath>
+
+//definitions of default configs
+const QString DEFAULT_CONFIG_NAME="Standard Mandelbrot";
+const MandelbrotConfig DEFAULT_CONFIG=
+        {"z^2+c",       //formula
+        4.0,            //limit
+        -0.637011f,     //centerX
+        -0.0395159f,    //centerY
+        0.00403897f,    //scale
+        100,            //nIterations
+        "",             //colorPaletteFileName
+        "n/m*(w-1)",    //paletteFormulaX
+        true,           //col0interior
+        "0",            //paletteFormulaY
+        false,          //row0interior
+        false,          //julia
+        0.0,            //juliaRe
+        0.0             //juliaIm
+        };
+const QString DEFAULT_CONFIG_SMOOTH_COLORING_NAME="Standard Mandelbrot (smooth coloring)";
+const MandelbrotConfig DEFAULT_CONFIG_SMOOTH_COLORING=
+        {"z^2+c",                                           //formula
+        20.0,                                                //limit
+        -0.637011f,                                         //centerX
+        -0.0395159f,                                        //centerY
+        0.00403897f,                                        //scale
+        100,                                                //nIterations
+        "",                                                 //colorPaletteFileName
+        "(n+1-log(log(s^2+t^2)/log(4))/log(2))/m*(w-1)",    //paletteFormulaX
+        true,                                               //col0interior
+        "0",                                                //paletteFormulaY
+        false,                                              //row0interior
+        false,                                              //julia
+        0.0,                                                //juliaRe
+        0.0                                                 //juliaIm
+        };
+
+bool readConfigFile(const QString &fileName, ConfigList &configs)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QTextStream in(&file);
+    QString name;
+    MandelbrotConfig config;
+    while(!in.atEnd())
+    {
+        name=in.readLine();
+        config.formula=in.readLine();
+        config.limit=in.readLine().toDouble();
+        config.centerX=BigFixed::fromString(in.readLine());
+        config.centerY=BigFixed::fromString(in.readLine());
+        config.scale=qMax(FloatExp::fromString(in.readLine()),MIN_SCALE);
+        config.nIterations=in.readLine().toInt();
+        config.colorPaletteFileName=in.readLine();
+        config.paletteFormulaX=in.readLine();
+        config.col0interior=!!in.readLine().toInt();
+        config.paletteFormulaY=in.readLine();
+        config.row0interior=!!in.readLine().toInt();
+        config.julia=!!in.readLine().toInt();
+        config.juliaRe=in.readLine().toDouble();
+        config.juliaIm=in.readLine().toDouble();
+        configs.push_back(std::make_pair(name,config));
+    }
+    return true;
+}
+
+bool writeConfigFile(const QString &fileName, const std::map<QString,MandelbrotConfig> &configs)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    std::map<QString,MandelbrotConfig>::const_iterator it=configs.begin();
+    QTextStream out(&file);
+    std::pair<QString,MandelbrotConfig> p;
+    while(it!=configs.end())
+    {
+        p=*it;
+        out<<p.first<<"\n";
+        out<<p.second.formula<<"\n";
+        out<<QString::number(p.second.limit)<<"\n";
+        out<<coordinateToString(p.second.centerX,p.second.scale)<<"\n";
+        out<<coordinateToString(p.second.centerY,p.second.scale)<<"\n";
+        out<<p.second.scale.toString()<<"\n";
+        out<<QString::number(p.second.nIterations)<<"\n";
+        out<<p.second.colorPaletteFileName<<"\n";
+        out<<p.second.paletteFormulaX<<"\n";
+        out<<QString::number((int)p.second.col0interior)<<"\n";
+        out<<p.second.paletteFormulaY<<"\n";
+        out<<QString::number((int)p.second.row0interior)<<"\n";
+        out<<QString::number((int)p.second.julia)<<"\n";
+        out<<QString::number(p.second.juliaRe)<<"\n";
+        out<<QString::number(p.second.juliaIm)<<"\n";
+        ++it;
+    }
+    return true;
+}
+
+//prints a coordinate with enough decimals to tell pixels apart at the given scale
+QString coordinateToString(const BigFixed &x, const FloatExp &scale)
+{
+    qint32 decimals=qMax(6,(qint32)std::ceil(-scale.log2()*0.30102999566398120)+4);
+    return x.toString(decimals);
+}
+
+QImage defaultColorPalette()
+{
+    static const qint32 width=256;
+    static const qint32 ncolors=8;
+    QImage defaultPalette(width,1,QImage::Format_RGB32);
+    QColor colors[]=
+    {
+        QColor(0,0,100),
+        QColor(0,0,255),
+        QColor(255,255,255),
+        QColor(0,0,255),
+        QColor(255,255,255),
+        QColor(240,70,0),
+        QColor(255,255,70),
+        QColor(255,255,255)
+    };
+    ((quint32*)defaultPalette.scanLine(0))[0]=(quint32)qRgb(0,0,0);
+    double seglength=(double)width/(double)(ncolors-1);
+    qint32 seg;
+    double pos;
+    for(qint32 i=1;i<width;++i)
+    {
+        seg=i*(ncolors-1)/width;
+        pos=((double)i-seg*seglength)/seglength;
+        ((quint32*)defaultPalette.scanLine(0))[i]=(quint32)qRgb(
+                colors[seg].red()*(1-pos)+colors[seg+1].red()*pos,
+                colors[seg].green()*(1-pos)+colors[seg+1].green()*pos,
+                colors[seg].blue()*(1-pos)+colors[seg+1].blue()*pos
+                    );
+
+    }
+    return defaultPalette;
+}
@@ -0,0 +1,31 @@
+#ifndef CONFIGIO_H
+#define CONFIGIO_H
+
+#include <QString>
+#include <QImage>
+#include <map>
+#include <utility>
+#include <vector>
+#include "mandelbrotset.h"
+
+//Reading and writing of configuration files like config.cfg, shared by the GUI and the command line renderer.
+//Every configuration takes one line for its name followed by one line per member of MandelbrotConfig.
+
+typedef std::vector<std::pair<QString,MandelbrotConfig> > ConfigList;
+
+//default config
+extern const QString DEFAULT_CONFIG_NAME;
+extern const MandelbrotConfig DEFAULT_CONFIG;
+//modified coloring formula to reduce banding
+extern const QString DEFAULT_CONFIG_SMOOTH_COLORING_NAME;
+extern const MandelbrotConfig DEFAULT_CONFIG_SMOOTH_COLORING;
+
+//reads the configurations of a file in file order, false if the file can't be opened
+bool readConfigFile(const QString& fileName,ConfigList& configs);
+bool writeConfigFile(const QString& fileName,const std::map<QString,MandelbrotConfig>& configs);
+//prints a coordinate with enough decimals to tell pixels apart at the given scale
+QString coordinateToString(const BigFixed& x,const FloatExp& scale);
+//palette used by configurations without a palette image
+QImage defaultColorPalette();
+
+#endif // CONFIGIO_H
@@ -0,0 +1,89 @@
+#ifndef DOUBLEDOUBLE_H
+#define DOUBLEDOUBLE_H
+
+//Unevaluated sum hi+lo of two doubles with |lo|<=ulp(hi)/2, good for about 106 bits of mantissa. Used to iterate
+//polynomial formulas directly at zoom levels just beyond double precision.
+//The error free transformations below only work if the compiler keeps every rounding step, so reassociation and
+//contraction are switched off for this header regardless of the -Ofast the project is built with.
+
+#if defined(__clang__)
+#pragma float_control(precise,on,push)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("no-fast-math","fp-contract=off")
+#endif
+
+struct DoubleDouble
+{
+    double hi;
+    double lo;
+    DoubleDouble(): hi(0.), lo(0.) {}
+    DoubleDouble(double d): hi(d), lo(0.) {}
+    DoubleDouble(double h,double l): hi(h), lo(l) {}
+
+    //s+e=a+b exactly
+    static inline DoubleDouble twoSum(double a,double b)
+    {
+        double s=a+b;
+        double bb=s-a;
+        return DoubleDouble(s,(a-(s-bb))+(b-bb));
+    }
+    //same as twoSum provided |a|>=|b|
+    static inline DoubleDouble quickTwoSum(double a,double b)
+    {
+        double s=a+b;
+        return DoubleDouble(s,b-(s-a));
+    }
+    //p+e=a*b exactly, using Dekker's splitting since FMA isn't available on every target
+    static inline DoubleDouble twoProd(double a,double b)
+    {
+        const double SPLIT=134217729.; //2^27+1
+        double p=a*b;
+        double ta=SPLIT*a,tb=SPLIT*b;
+        double ah=ta-(ta-a),bh=tb-(tb-b);
+        double al=a-ah,bl=b-bh;
+        return DoubleDouble(p,((ah*bh-p)+ah*bl+al*bh)+al*bl);
+    }
+};
+
+inline DoubleDouble operator-(const DoubleDouble& a)
+{
+    return DoubleDouble(-a.hi,-a.lo);
+}
+
+inline DoubleDouble operator+(const DoubleDouble& a,const DoubleDouble& b)
+{
+    DoubleDouble s=DoubleDouble::twoSum(a.hi,b.hi);
+    DoubleDouble t=DoubleDouble::twoSum(a.lo,b.lo);
+    s=DoubleDouble::quickTwoSum(s.hi,s.lo+t.hi);
+    return DoubleDouble::quickTwoSum(s.hi,s.lo+t.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a,const DoubleDouble& b)
+{
+    return a+(-b);
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a,const DoubleDouble& b)
+{
+    DoubleDouble p=DoubleDouble::twoProd(a.hi,b.hi);
+    return DoubleDouble::quickTwoSum(p.hi,p.lo+(a.hi*b.lo+a.lo*b.hi));
+}
+
+inline DoubleDouble& operator+=(DoubleDouble& a,const DoubleDouble& b)
+{
+    return a=a+b;
+}
+
+inline bool operator<=(const DoubleDouble& a,const DoubleDouble& b)
+{
+    return a.hi<b.hi || (a.hi==b.hi && a.lo<=b.lo);
+}
+
+#if defined(__clang__)
+#pragma float_control(pop)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif // DOUBLEDOUBLE_H
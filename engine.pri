@@ -0,0 +1,41 @@
+#-------------------------------------------------
+#
+# Render engine shared by the GUI and the command line renderer
+#
+#-------------------------------------------------
+CONFIG += c++11
+
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -Ofast
+
+SOURCES += mandelbrotset.cpp \
+        formulakernels.cpp \
+        simdkernels.cpp \
+        batcheval.cpp \
+        bigfixed.cpp \
+        floatexp.cpp \
+        perturbation.cpp \
+        tilecache.cpp \
+        palettesampler.cpp \
+        configio.cpp \
+        posterrenderer.cpp \
+        zoomsequence.cpp \
+        exponentialmap.cpp
+
+HEADERS  += mandelbrotset.h \
+            formulakernels.h \
+            simdkernels.h \
+            batcheval.h \
+            iterationbuffer.h \
+            tilecache.h \
+            palettesampler.h \
+            configio.h \
+            posterrenderer.h \
+            zoomsequence.h \
+            exponentialmap.h \
+            bigfixed.h \
+            perturbation.h \
+            precision.h \
+            doubledouble.h \
+            floatexp.h \
+            MathParser/mathparser.h
@@ -0,0 +1,76 @@
+#include "exponentialmap.h"
+#include <QtMath>
+#include <cmath>
+
+const double ExponentialRemapper::MIN_DISTANCE=0.5;
+
+ExponentialRemapper::ExponentialRemapper(qint32 stripWidth, qint32 width, qint32 height): stripWidth_(stripWidth), width_(width), height_(height)
+{
+    //frame pixels are centered the way the engine centers views, strip column 0 points along the real axis
+    const double perRadian=stripWidth/(2*M_PI);
+    columns_.resize((size_t)width*height);
+    rows_.resize((size_t)width*height);
+    minRow_=0;
+    maxRow_=0;
+    for(qint32 y=0;y<height;++y)
+        for(qint32 x=0;x<width;++x)
+        {
+            double dx=x-width/2,dy=y-height/2;
+            double angle=std::atan2(dy,dx);
+            size_t p=(size_t)y*width+x;
+            columns_[p]=(float)((angle<0?angle+2*M_PI:angle)*perRadian);
+            rows_[p]=(float)(-std::log(qMax(std::sqrt(dx*dx+dy*dy),MIN_DISTANCE))*perRadian);
+            minRow_=qMin(minRow_,rows_[p]);
+            maxRow_=qMax(maxRow_,rows_[p]);
+        }
+}
+
+qint32 ExponentialRemapper::matchingStripWidth(qint32 width, qint32 height)
+{
+    double corner=std::sqrt((double)width*width+(double)height*height)/2;
+    return ((qint32)std::ceil(2*M_PI*corner)+7)&~7;
+}
+
+double ExponentialRemapper::firstRow(const FloatExp &stripRadius, const FloatExp &scale) const
+{
+    return (stripRadius/scale).log2()*M_LN2*stripWidth_/(2*M_PI)+minRow_;
+}
+
+double ExponentialRemapper::lastRow(const FloatExp &stripRadius, const FloatExp &scale) const
+{
+    return (stripRadius/scale).log2()*M_LN2*stripWidth_/(2*M_PI)+maxRow_;
+}
+
+QImage ExponentialRemapper::remap(const QImage &strip, qint32 stripFirstRow, const FloatExp &stripRadius, const FloatExp &scale) const
+{
+    QImage frame(width_,height_,QImage::Format_RGB32);
+    const float shift=(float)((stripRadius/scale).log2()*M_LN2*stripWidth_/(2*M_PI)-stripFirstRow);
+    const float maxRow=(float)(strip.height()-1);
+    for(qint32 y=0;y<height_;++y)
+    {
+        quint32* out=reinterpret_cast<quint32*>(frame.scanLine(y));
+        const float* columns=&columns_[(size_t)y*width_];
+        const float* rows=&rows_[(size_t)y*width_];
+        for(qint32 x=0;x<width_;++x)
+        {
+            //columns wrap around the circle, rows are clamped to the strip
+            float u=columns[x],v=qBound(0.f,rows[x]+shift,maxRow);
+            qint32 iu=(qint32)u,iv=qMin((qint32)v,strip.height()-2);
+            float fu=u-iu,fv=v-iv;
+            qint32 iu0=iu%stripWidth_,iu1=(iu+1)%stripWidth_;
+            const quint32* row0=reinterpret_cast<const quint32*>(strip.constScanLine(iv));
+            const quint32* row1=reinterpret_cast<const quint32*>(strip.constScanLine(iv+1));
+            quint32 c[4]={row0[iu0],row0[iu1],row1[iu0],row1[iu1]};
+            float w[4]={(1-fu)*(1-fv),fu*(1-fv),(1-fu)*fv,fu*fv};
+            float r=0,g=0,b=0;
+            for(qint32 n=0;n<4;++n)
+            {
+                r+=w[n]*qRed(c[n]);
+                g+=w[n]*qGreen(c[n]);
+                b+=w[n]*qBlue(c[n]);
+            }
+            out[x]=qRgb(qRound(r),qRound(g),qRound(b));
+        }
+    }
+    return frame;
+}
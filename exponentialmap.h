@@ -0,0 +1,36 @@
+#ifndef EXPONENTIALMAP_H
+#define EXPONENTIALMAP_H
+
+#include "floatexp.h"
+#include <QImage>
+#include <vector>
+
+//Turns an exponential map strip (see RenderRequest::exponential) into ordinary frames around its center.
+//The strip row of a frame pixel at distance d pixels from the center is log(radius/(scale*d))*width/2pi,
+//so the scale only shifts all rows by the same amount. Rows and columns are tabulated once per frame size,
+//which leaves a table lookup and a bilinear sample per pixel of every frame.
+
+class ExponentialRemapper
+{
+public:
+    ExponentialRemapper(qint32 stripWidth,qint32 width,qint32 height);
+    //columns at which strip pixels are as large as frame pixels in the corners of a frame
+    static qint32 matchingStripWidth(qint32 width,qint32 height);
+    //strip rows covered by a frame of the given scale, for a strip whose row 0 has the given radius
+    double firstRow(const FloatExp& stripRadius,const FloatExp& scale) const;
+    double lastRow(const FloatExp& stripRadius,const FloatExp& scale) const;
+    //strip holds the rows from stripFirstRow on, rows outside it are clamped
+    QImage remap(const QImage& strip,qint32 stripFirstRow,const FloatExp& stripRadius,const FloatExp& scale) const;
+private:
+    //distance of the innermost pixel to the center, in pixels
+    static const double MIN_DISTANCE;
+    qint32 stripWidth_;
+    qint32 width_;
+    qint32 height_;
+    //strip column of every frame pixel and its row for scale==stripRadius
+    std::vector<float> columns_;
+    std::vector<float> rows_;
+    float minRow_,maxRow_;
+};
+
+#endif // EXPONENTIALMAP_H
@@ -0,0 +1,56 @@
+#include "floatexp.h"
+
+namespace
+{
+
+//10^n by binary powering, within a few ulps for any exponent
+FloatExp pow10(qint32 n)
+{
+    FloatExp result(1.),base(10.);
+    for(qint32 k=qAbs(n);k;k>>=1,base=base*base)
+        if(k&1)
+            result=result*base;
+    return (n<0)?FloatExp(1.)/result:result;
+}
+
+}
+
+FloatExp FloatExp::fromString(const QString &str, bool *ok)
+{
+    QString s=str.trimmed();
+    qint32 pos=s.indexOf('e',0,Qt::CaseInsensitive);
+    bool valid;
+    double mantissa=s.left(pos).toDouble(&valid);
+    qint32 exponent=0;
+    if(valid && pos>=0)
+        exponent=s.mid(pos+1).toInt(&valid);
+    //larger exponents would overflow the binary one
+    valid=valid && std::isfinite(mantissa) && qAbs(exponent)<=100000000;
+    if(ok)
+        *ok=valid;
+    if(!valid)
+        return FloatExp();
+    return FloatExp(mantissa)*pow10(exponent);
+}
+
+QString FloatExp::toString(qint32 digits) const
+{
+    //well within the normal range of double, where its conversion is exact
+    if(m==0. || qAbs(e)<1000)
+        return QString::number((double)*this,'g',digits);
+    //m*2^e=mantissa*10^exponent with 1<=|mantissa|<10, which may round up to 10
+    qint32 exponent=(qint32)std::floor(log2()*0.30102999566398120);
+    double mantissa=(double)(*this/pow10(exponent));
+    if(std::fabs(mantissa)<1.)
+    {
+        mantissa*=10.;
+        --exponent;
+    }
+    QString digitString=QString::number(mantissa,'g',digits);
+    if(std::fabs(digitString.toDouble())>=10.)
+    {
+        ++exponent;
+        digitString=QString::number(mantissa/10.,'g',digits);
+    }
+    return digitString+(exponent<0?"e-":"e+")+QString::number(qAbs(exponent));
+}
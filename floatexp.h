@@ -0,0 +1,109 @@
+#ifndef FLOATEXP_H
+#define FLOATEXP_H
+
+#include <QtGlobal>
+#include <QString>
+#include <cmath>
+
+//Double mantissa with a separate 32 bit exponent. Perturbation deltas at the deepest zoom levels get close to the
+//smallest normal double, where -Ofast flushes them to zero, FloatExp keeps their full precision at any magnitude.
+//Scales are FloatExp for the same reason, so views can be zoomed in beyond the range of double.
+
+struct FloatExp
+{
+    //0.5<=|m|<1, or m=0 and e=0
+    double m;
+    qint32 e;
+    FloatExp(): m(0.), e(0) {}
+    FloatExp(double d) {m=std::frexp(d,&e);}
+    FloatExp(double mantissa,qint32 exponent)
+    {
+        m=std::frexp(mantissa,&e);
+        e=m!=0.?e+exponent:0;
+    }
+    explicit operator double() const {return std::ldexp(m,e);}
+    //binary logarithm, of the magnitude for negative values
+    double log2() const {return std::log2(std::fabs(m))+e;}
+    //2^x for any x whose integer part fits the exponent
+    static FloatExp fromLog2(double x)
+    {
+        double whole=std::floor(x);
+        return FloatExp(std::exp2(x-whole),(qint32)whole);
+    }
+    //parses decimal numbers like 1.5e-4000, exponents aren't limited to the range of double
+    static FloatExp fromString(const QString& str,bool* ok=0);
+    //the same representation as QString::number within the range of double, significant digits as given
+    QString toString(qint32 digits=6) const;
+};
+
+inline FloatExp operator-(const FloatExp& a)
+{
+    FloatExp r=a;
+    r.m=-r.m;
+    return r;
+}
+
+inline FloatExp operator*(const FloatExp& a,const FloatExp& b)
+{
+    return FloatExp(a.m*b.m,a.e+b.e);
+}
+
+inline FloatExp operator+(const FloatExp& a,const FloatExp& b)
+{
+    //zeros have exponent 0, so they're handled before comparing exponents
+    if(a.m==0.)
+        return b;
+    if(b.m==0.)
+        return a;
+    //operands more than 60 binary orders apart don't affect each other's mantissa
+    if(b.e-a.e>60)
+        return b;
+    if(a.e-b.e>60)
+        return a;
+    if(a.e>=b.e)
+        return FloatExp(a.m+std::ldexp(b.m,b.e-a.e),a.e);
+    return FloatExp(std::ldexp(a.m,a.e-b.e)+b.m,b.e);
+}
+
+inline FloatExp operator-(const FloatExp& a,const FloatExp& b)
+{
+    return a+(-b);
+}
+
+inline FloatExp operator/(const FloatExp& a,const FloatExp& b)
+{
+    return FloatExp(a.m/b.m,a.e-b.e);
+}
+
+//mantissa and exponent are unique, so comparisons don't need to convert
+inline bool operator==(const FloatExp& a,const FloatExp& b)
+{
+    return a.m==b.m && a.e==b.e;
+}
+
+inline bool operator!=(const FloatExp& a,const FloatExp& b)
+{
+    return !(a==b);
+}
+
+inline bool operator<(const FloatExp& a,const FloatExp& b)
+{
+    return (a-b).m<0.;
+}
+
+inline bool operator>(const FloatExp& a,const FloatExp& b)
+{
+    return b<a;
+}
+
+inline bool operator<=(const FloatExp& a,const FloatExp& b)
+{
+    return !(b<a);
+}
+
+inline bool operator>=(const FloatExp& a,const FloatExp& b)
+{
+    return !(a<b);
+}
+
+#endif // FLOATEXP_H
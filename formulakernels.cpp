@@ -0,0 +1,143 @@
+#include "formulakernels.h"
+#include <QByteArray>
+
+namespace
+{
+
+//recursive descent recognizer for the grammar
+//sum:   power '+' 'c' | 'c' '+' power
+//power: 'z' '^' integer | '(' sum ')' '^' integer
+class PolynomialRecognizer
+{
+public:
+    PolynomialRecognizer(const QByteArray& str): str_(str), pos_(0) {}
+    bool parse(std::vector<qint32>& exponents)
+    {
+        exponents.clear();
+        return parseSum(exponents) && pos_==str_.size();
+    }
+private:
+    bool accept(char ch)
+    {
+        if(pos_<str_.size() && str_.at(pos_)==ch)
+        {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+    bool parseInteger(qint32& k)
+    {
+        qint32 start=pos_;
+        k=0;
+        while(pos_<str_.size() && str_.at(pos_)>='0' && str_.at(pos_)<='9' && k<1000)
+            k=k*10+(str_.at(pos_++)-'0');
+        return pos_>start;
+    }
+    bool parseSum(std::vector<qint32>& exponents)
+    {
+        if(accept('c'))
+            return accept('+') && parsePower(exponents);
+        return parsePower(exponents) && accept('+') && accept('c');
+    }
+    bool parsePower(std::vector<qint32>& exponents)
+    {
+        if(accept('('))
+        {
+            if(!parseSum(exponents) || !accept(')'))
+                return false;
+        }
+        else if(!accept('z'))
+            return false;
+        qint32 k;
+        if(!accept('^') || !parseInteger(k) || k<2)
+            return false;
+        exponents.push_back(k);
+        return true;
+    }
+    QByteArray str_;
+    qint32 pos_;
+};
+
+//kernels of one number type, indexed by the exponents of the formula
+template<typename T,bool PERIODIC=false> struct PolynomialKernels
+{
+    typedef EscapeKernel Kernel;
+    template<int... K> static Kernel get() {return PERIODIC?&periodicPolynomialKernel<T,K...>:&polynomialKernel<T,K...>;}
+};
+
+template<> struct PolynomialKernels<DoubleDouble,false>
+{
+    typedef DoubleDoubleKernel Kernel;
+    template<int... K> static Kernel get() {return &doubleDoubleKernel<K...>;}
+};
+
+template<typename T,bool PERIODIC,int K1> typename PolynomialKernels<T,PERIODIC>::Kernel selectNested(qint32 k2)
+{
+    typedef PolynomialKernels<T,PERIODIC> Kernels;
+    switch(k2)
+    {
+    case 2: return Kernels::template get<K1,2>();
+    case 3: return Kernels::template get<K1,3>();
+    case 4: return Kernels::template get<K1,4>();
+    default: return 0;
+    }
+}
+
+template<typename T,bool PERIODIC> typename PolynomialKernels<T,PERIODIC>::Kernel selectKernel(const QString& formula)
+{
+    typedef PolynomialKernels<T,PERIODIC> Kernels;
+    std::vector<qint32> exponents;
+    if(!recognizePolynomialFormula(formula,exponents))
+        return 0;
+    if(exponents.size()==1)
+    {
+        switch(exponents[0])
+        {
+        case 2: return Kernels::template get<2>();
+        case 3: return Kernels::template get<3>();
+        case 4: return Kernels::template get<4>();
+        case 5: return Kernels::template get<5>();
+        case 6: return Kernels::template get<6>();
+        case 7: return Kernels::template get<7>();
+        case 8: return Kernels::template get<8>();
+        default: return 0;
+        }
+    }
+    else if(exponents.size()==2)
+    {
+        switch(exponents[0])
+        {
+        case 2: return selectNested<T,PERIODIC,2>(exponents[1]);
+        case 3: return selectNested<T,PERIODIC,3>(exponents[1]);
+        case 4: return selectNested<T,PERIODIC,4>(exponents[1]);
+        default: return 0;
+        }
+    }
+    return 0;
+}
+
+}
+
+bool recognizePolynomialFormula(const QString &formula, std::vector<qint32> &exponents)
+{
+    QString str=formula;
+    str.remove(' ');
+    PolynomialRecognizer recognizer(str.toLatin1());
+    return recognizer.parse(exponents);
+}
+
+EscapeKernel selectEscapeKernel(const QString &formula, bool periodicity)
+{
+    return periodicity?selectKernel<double,true>(formula):selectKernel<double,false>(formula);
+}
+
+EscapeKernel selectFloatEscapeKernel(const QString &formula, bool periodicity)
+{
+    return periodicity?selectKernel<float,true>(formula):selectKernel<float,false>(formula);
+}
+
+DoubleDoubleKernel selectDoubleDoubleKernel(const QString &formula)
+{
+    return selectKernel<DoubleDouble,false>(formula);
+}
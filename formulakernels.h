@@ -0,0 +1,144 @@
+#ifndef FORMULAKERNELS_H
+#define FORMULAKERNELS_H
+
+#include <QString>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include "doubledouble.h"
+
+//Hand-written escape time kernels for polynomial formulas of the form (...((z^k1+c)^k2+c)...)^kn+c.
+//They replace the interpreted MathEval loop for the most commonly used formulas.
+
+//iterates z=f(z) while it<nIt and |z|^2<=limit, returns the number of iterations done. z is updated in place.
+typedef qint32 (*EscapeKernel)(double& zr,double& zi,double cr,double ci,qint32 nIt,double limit);
+//the same in double-double precision, for views too deep for double which perturbation can't handle
+typedef qint32 (*DoubleDoubleKernel)(DoubleDouble& zr,DoubleDouble& zi,const DoubleDouble& cr,const DoubleDouble& ci,qint32 nIt,double limit);
+
+//z^K by repeated squaring, unrolled at compile time
+template<typename T,int K> struct ComplexPow
+{
+    static inline void apply(T& re,T& im)
+    {
+        T r=re,i=im;
+        ComplexPow<T,K/2>::apply(re,im);
+        T sq=re*re-im*im;
+        im=(T)2*re*im;
+        re=sq;
+        if(K&1)
+        {
+            T tmp=re*r-im*i;
+            im=re*i+im*r;
+            re=tmp;
+        }
+    }
+};
+
+template<typename T> struct ComplexPow<T,1>
+{
+    static inline void apply(T&,T&) {}
+};
+
+//one application of f, K being the exponents from the innermost to the outermost power
+template<typename T,int K,int... Rest> struct PolynomialStep
+{
+    static inline void apply(T& zr,T& zi,T cr,T ci)
+    {
+        ComplexPow<T,K>::apply(zr,zi);
+        zr+=cr;
+        zi+=ci;
+        PolynomialStep<T,Rest...>::apply(zr,zi,cr,ci);
+    }
+};
+
+template<typename T,int K> struct PolynomialStep<T,K>
+{
+    static inline void apply(T& zr,T& zi,T cr,T ci)
+    {
+        ComplexPow<T,K>::apply(zr,zi);
+        zr+=cr;
+        zi+=ci;
+    }
+};
+
+template<typename T,int... K> qint32 polynomialKernel(double& zr,double& zi,double cr,double ci,qint32 nIt,double limit)
+{
+    T r=(T)zr,i=(T)zi;
+    const T cRe=(T)cr,cIm=(T)ci,lim=(T)limit;
+    qint32 it=0;
+    while(it<nIt && r*r+i*i<=lim)
+    {
+        PolynomialStep<T,K...>::apply(r,i,cRe,cIm);
+        ++it;
+    }
+    zr=(double)r;
+    zi=(double)i;
+    return it;
+}
+
+//orbits coming back this close to an earlier point are taken to have converged to a cycle
+template<typename T> inline T periodicityTolerance()
+{
+    return std::numeric_limits<T>::epsilon()*64;
+}
+
+//polynomialKernel with Brent's cycle detection: z is compared to a saved point which is replaced after 1,2,4,...
+//iterations. Once the orbit returns to the saved point it never escapes, so nIt is returned right away.
+template<typename T,int... K> qint32 periodicPolynomialKernel(double& zr,double& zi,double cr,double ci,qint32 nIt,double limit)
+{
+    T r=(T)zr,i=(T)zi;
+    const T cRe=(T)cr,cIm=(T)ci,lim=(T)limit;
+    const T tolerance=periodicityTolerance<T>();
+    T savedR=r,savedI=i;
+    qint32 it=0,period=0,checkPeriod=1;
+    while(it<nIt && r*r+i*i<=lim)
+    {
+        PolynomialStep<T,K...>::apply(r,i,cRe,cIm);
+        ++it;
+        if(std::abs(r-savedR)<tolerance && std::abs(i-savedI)<tolerance)
+        {
+            it=nIt;
+            break;
+        }
+        if(++period==checkPeriod)
+        {
+            period=0;
+            checkPeriod*=2;
+            savedR=r;
+            savedI=i;
+        }
+    }
+    zr=(double)r;
+    zi=(double)i;
+    return it;
+}
+
+template<int... K> qint32 doubleDoubleKernel(DoubleDouble& zr,DoubleDouble& zi,const DoubleDouble& cr,const DoubleDouble& ci,qint32 nIt,double limit)
+{
+    const DoubleDouble lim(limit);
+    qint32 it=0;
+    while(it<nIt && zr*zr+zi*zi<=lim)
+    {
+        PolynomialStep<DoubleDouble,K...>::apply(zr,zi,cr,ci);
+        ++it;
+    }
+    return it;
+}
+
+//points in the main cardioid and the period 2 bulb of z^2+c, which never escape
+inline bool insideCardioidOrBulb(double cr,double ci)
+{
+    double x=cr-0.25,ci2=ci*ci;
+    double q=x*x+ci2;
+    return q*(q+x)<=0.25*ci2 || (cr+1.)*(cr+1.)+ci2<=0.0625;
+}
+
+//recognizes formulas of the form (...((z^k1+c)^k2+c)...)^kn+c, exponents are returned innermost first
+bool recognizePolynomialFormula(const QString& formula,std::vector<qint32>& exponents);
+//returns a kernel for the formula or 0 if the formula has to be run by the interpreter
+EscapeKernel selectEscapeKernel(const QString& formula,bool periodicity=false);
+//the same kernels iterating in single precision, for overviews
+EscapeKernel selectFloatEscapeKernel(const QString& formula,bool periodicity=false);
+DoubleDoubleKernel selectDoubleDoubleKernel(const QString& formula);
+
+#endif // FORMULAKERNELS_H
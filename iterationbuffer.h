@@ -0,0 +1,160 @@
+#ifndef ITERATIONBUFFER_H
+#define ITERATIONBUFFER_H
+
+#include <QString>
+#include "bigfixed.h"
+#include "precision.h"
+#include <vector>
+#include <utility>
+
+//identifies the view and formula an iteration buffer was computed for. the iteration count is not part of the key,
+//raising it continues from the stored state.
+struct IterationKey
+{
+    QString formula;
+    bool julia;
+    double cRe;
+    double cIm;
+    double limit;
+    BigFixed xCenter;
+    BigFixed yCenter;
+    FloatExp scale;
+    qint32 width;
+    qint32 height;
+    //number type the pixels were iterated in, states from another one don't match what a fresh render would compute
+    Precision precision;
+    bool deep;
+    bool exponential;
+    bool operator==(const IterationKey& other) const
+    {
+        return formula==other.formula && julia==other.julia && (!julia || (cRe==other.cRe && cIm==other.cIm)) &&
+                limit==other.limit && xCenter==other.xCenter && yCenter==other.yCenter && scale==other.scale &&
+                width==other.width && height==other.height && precision==other.precision && deep==other.deep &&
+                exponential==other.exponential;
+    }
+    bool operator!=(const IterationKey& other) const {return !(*this==other);}
+    //true if other is this view moved by whole pixels, dx,dy is the offset of the image content in pixels.
+    //centers computed by adding pixel offsets in floating point are accepted within a millionth of a pixel.
+    bool panOffset(const IterationKey& other,qint32& dx,qint32& dy) const
+    {
+        IterationKey moved=other;
+        moved.xCenter=xCenter;
+        moved.yCenter=yCenter;
+        if(moved!=*this || exponential)
+            return false;
+        double x=(double)((xCenter-other.xCenter).toFloatExp()/scale);
+        double y=(double)((yCenter-other.yCenter).toFloatExp()/scale);
+        if(qAbs(x)>=width || qAbs(y)>=height)
+            return false;
+        dx=qRound(x);
+        dy=qRound(y);
+        return qAbs(x-dx)<1e-6 && qAbs(y-dy)<1e-6;
+    }
+    //true if other is this view zoomed about its center by an integer factor. zoomOut>1 means other's pixels are zoomOut
+    //pixels of this view apart, zoomIn>1 that every zoomIn-th pixel of other coincides with a pixel of this view.
+    bool zoomFactor(const IterationKey& other,qint32& zoomIn,qint32& zoomOut) const
+    {
+        IterationKey zoomed=other;
+        zoomed.scale=scale;
+        if(zoomed!=*this || other.scale==scale || exponential)
+            return false;
+        double outRatio=(double)(other.scale/scale),inRatio=(double)(scale/other.scale);
+        zoomIn=qMax(1,qRound(inRatio));
+        zoomOut=qMax(1,qRound(outRatio));
+        return qAbs(outRatio-zoomOut)<1e-9*outRatio || qAbs(inRatio-zoomIn)<1e-9*inRatio;
+    }
+};
+
+//per-pixel state of the escape time loop, kept between passes and between renders of the same view,
+//so later passes only continue the pixels which haven't escaped yet
+struct IterationBuffer
+{
+    //glitched pixels lost precision during perturbation and are iterated again with another reference,
+    //interior pixels are known to never escape and are reported as having reached the iteration limit.
+    //filled pixels were filled with the state of an escaped border in subdivision mode, they count as escaped
+    //and are iterated from the beginning once a pass computes them.
+    enum Status {ITERATING=0,ESCAPED=1,GLITCHED=2,INTERIOR=3,FILLED=4};
+    IterationKey key;
+    //largest iteration count a pass has been started with
+    qint32 maxIterations;
+    //every pixel has either escaped or been iterated at least this many times
+    qint32 completedIterations;
+    std::vector<double> zr,zi;
+    //number of iterations done, -1 if the pixel hasn't been started yet
+    std::vector<qint32> it;
+    std::vector<quint8> status;
+    IterationBuffer(): maxIterations(0), completedIterations(0) {key.width=key.height=0;}
+    bool isEmpty() const {return it.empty();}
+    bool escaped(size_t p) const {return status[p]==ESCAPED || status[p]==FILLED;}
+    void reset(const IterationKey& k)
+    {
+        size_t n=(size_t)k.width*k.height;
+        key=k;
+        maxIterations=completedIterations=0;
+        zr.resize(n);
+        zi.resize(n);
+        it.assign(n,-1);
+        status.assign(n,ITERATING);
+    }
+    //keeps the state of the pixels of the view k which coincide with pixels of the current view, see IterationKey::zoomFactor
+    void zoom(const IterationKey& k,qint32 zoomIn,qint32 zoomOut)
+    {
+        IterationBuffer old;
+        std::swap(*this,old);
+        reset(k);
+        maxIterations=old.maxIterations;
+        qint32 halfWidth=k.width/2,halfHeight=k.height/2;
+        for(qint32 y=0;y<k.height;++y)
+        {
+            qint32 dy=(y-halfHeight)*zoomOut;
+            if(dy%zoomIn)
+                continue;
+            qint32 sy=dy/zoomIn+halfHeight;
+            for(qint32 x=0;x<k.width;++x)
+            {
+                qint32 dx=(x-halfWidth)*zoomOut;
+                qint32 sx=dx/zoomIn+halfWidth;
+                if(dx%zoomIn || sx<0 || sx>=k.width || sy<0 || sy>=k.height)
+                    continue;
+                size_t p=(size_t)y*k.width+x,q=(size_t)sy*k.width+sx;
+                zr[p]=old.zr[q];
+                zi[p]=old.zi[q];
+                it[p]=old.it[q];
+                status[p]=old.status[q];
+            }
+        }
+    }
+    //moves the state of all pixels by dx,dy for the view k, pixels moved in from outside are reset
+    void shift(const IterationKey& k,qint32 dx,qint32 dy)
+    {
+        key=k;
+        completedIterations=0;
+        qint32 w=k.width,h=k.height;
+        //rows and pixels are visited against the direction of the move, so sources are read before being overwritten
+        for(qint32 j=0;j<h;++j)
+        {
+            qint32 y=(dy>0)?h-1-j:j;
+            for(qint32 i=0;i<w;++i)
+            {
+                qint32 x=(dx>0)?w-1-i:i;
+                size_t p=(size_t)y*w+x;
+                qint32 sx=x-dx,sy=y-dy;
+                if(sx>=0 && sx<w && sy>=0 && sy<h)
+                {
+                    size_t q=(size_t)sy*w+sx;
+                    zr[p]=zr[q];
+                    zi[p]=zi[q];
+                    it[p]=it[q];
+                    status[p]=status[q];
+                }
+                else
+                {
+                    it[p]=-1;
+                    status[p]=ITERATING;
+                }
+            }
+        }
+    }
+};
+
+#endif // ITERATIONBUFFER_H
@@ -1,45 +1,13 @@
 #include "mandelbrotmainwindow.h"
 #include "ui_mandelbrotmainwindow.h"
-#include <QFile>
-#include <QTextStream>
 #include <QToolTip>
 #include <QMimeData>
-
-//definitions of default configs
-const QString MandelbrotMainWindow::DEFAULT_CONFIG_NAME="Standard Mandelbrot";
-const MandelbrotConfig MandelbrotMainWindow::DEFAULT_CONFIG=
-        {"z^2+c",       //formula
-        4.0,            //limit
-        -0.637011f,     //centerX
-        -0.0395159f,    //centerY
-        0.00403897f,    //scale
-        100,            //nIterations
-        "",             //colorPaletteFileName
-        "n/m*(w-1)",    //paletteFormulaX
-        true,           //col0interior
-        "0",            //paletteFormulaY
-        false,          //row0interior
-        false,          //julia
-        0.0,            //juliaRe
-        0.0             //juliaIm
-        };
-const QString MandelbrotMainWindow::DEFAULT_CONFIG_SMOOTH_COLORING_NAME="Standard Mandelbrot (smooth coloring)";
-const MandelbrotConfig MandelbrotMainWindow::DEFAULT_CONFIG_SMOOTH_COLORING=
-        {"z^2+c",                                           //formula
-        20.0,                                                //limit
-        -0.637011f,                                         //centerX
-        -0.0395159f,                                        //centerY
-        0.00403897f,                                        //scale
-        100,                                                //nIterations
-        "",                                                 //colorPaletteFileName
-        "(n+1-log(log(s^2+t^2)/log(4))/log(2))/m*(w-1)",    //paletteFormulaX
-        true,                                               //col0interior
-        "0",                                                //paletteFormulaY
-        false,                                              //row0interior
-        false,                                              //julia
-        0.0,                                                //juliaRe
-        0.0                                                 //juliaIm
-        };
+#include <QInputDialog>
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <QPainter>
+#include <QCursor>
 
 const qint32 MandelbrotMainWindow::MIN_ZOOM_WIDTH=20;
 const qint32 MandelbrotMainWindow::MIN_ZOOM_HEIGHT=20;
@@ -50,14 +18,23 @@ const double MandelbrotMainWindow::DEFAULT_SCALE=0.007;
 const double MandelbrotMainWindow::DEFAULT_LIMIT=100.;
 
 const qint32 MandelbrotMainWindow::PASSES=2;
+const QString MandelbrotMainWindow::STATS_LOG_FILE_NAME="render.log";
 
 MandelbrotMainWindow::MandelbrotMainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MandelbrotMainWindow)
+    ui(new Ui::MandelbrotMainWindow),
+    posterRunning(false),
+    posterHeight(0),
+    imageScale(0.),
+    requestedScale(0.),
+    requestedGeneration(0),
+    tileGeneration(0)
 {
     //set up multithreading
     mandelbrotSet.moveToThread(&workerThread);
     workerThread.start();
+    posterRenderer.moveToThread(&posterThread);
+    posterThread.start();
 
     //set up UI and render area
     ui->setupUi(this);
@@ -75,17 +52,32 @@ MandelbrotMainWindow::MandelbrotMainWindow(QWidget *parent) :
     ui->renderProgressBar->setVisible(false);
 
     //set up communication between mandelbrotSet object and this window
-    QObject::connect(&mandelbrotSet,SIGNAL(imageOut(QImage)),this,SLOT(updateImage(QImage)),Qt::QueuedConnection);
+    QObject::connect(&mandelbrotSet,SIGNAL(imageOut(QImage,int)),this,SLOT(updateImage(QImage,int)),Qt::QueuedConnection);
+    QObject::connect(&mandelbrotSet,SIGNAL(tileOut(QImage,int,int,int)),this,SLOT(updateTile(QImage,int,int,int)),Qt::QueuedConnection);
     QObject::connect(&mandelbrotSet,SIGNAL(errorCodeOut(int)),this,SLOT(receiveErrorCode(int)),Qt::QueuedConnection);
+    QObject::connect(&mandelbrotSet,SIGNAL(precisionOut(QString)),this,SLOT(receivePrecision(QString)),Qt::QueuedConnection);
+    QObject::connect(&mandelbrotSet,SIGNAL(seriesSkipOut(int)),this,SLOT(receiveSeriesSkip(int)),Qt::QueuedConnection);
+    QObject::connect(&mandelbrotSet,SIGNAL(computedPixelsOut(double)),this,SLOT(receiveComputedPixels(double)),Qt::QueuedConnection);
+    QObject::connect(&mandelbrotSet,SIGNAL(tileCacheOut(int,int)),this,SLOT(receiveTileCacheStats(int,int)),Qt::QueuedConnection);
+    QObject::connect(&mandelbrotSet,SIGNAL(statsOut(RenderStats)),this,SLOT(receiveRenderStats(RenderStats)),Qt::QueuedConnection);
     QObject::connect(&mandelbrotSet,SIGNAL(linesRendered(int)),ui->renderProgressBar,SLOT(setValue(int)),Qt::QueuedConnection);
-    QObject::connect(this,SIGNAL(renderMandelbrot(double,double,int,int,double,int,double,int)),&mandelbrotSet,SLOT(renderMandelbrot(double,double,int,int,double,int,double,int)),Qt::QueuedConnection);
-    QObject::connect(this,SIGNAL(renderJulia(double,double,int,int,double,int,double,int,double,double)),&mandelbrotSet,SLOT(renderJulia(double,double,int,int,double,int,double,int,double,double)),Qt::QueuedConnection);
+    QObject::connect(this,SIGNAL(render(RenderRequest)),&mandelbrotSet,SLOT(render(RenderRequest)),Qt::QueuedConnection);
+    QObject::connect(this,SIGNAL(recolor(int)),&mandelbrotSet,SLOT(recolor(int)),Qt::QueuedConnection);
     QObject::connect(this,SIGNAL(parseFormula(QString)),&mandelbrotSet,SLOT(parseFormula(QString)),Qt::QueuedConnection);
     QObject::connect(this,SIGNAL(parsePaletteXFormula(QString)),&mandelbrotSet,SLOT(parsePaletteXFormula(QString)),Qt::QueuedConnection);
     QObject::connect(this,SIGNAL(parsePaletteYFormula(QString)),&mandelbrotSet,SLOT(parsePaletteYFormula(QString)),Qt::QueuedConnection);
     QObject::connect(this,SIGNAL(setCol0Interior(bool)),&mandelbrotSet,SLOT(setCol0Interior(bool)),Qt::QueuedConnection);
     QObject::connect(this,SIGNAL(setRow0Interior(bool)),&mandelbrotSet,SLOT(setRow0Interior(bool)),Qt::QueuedConnection);
+    QObject::connect(this,SIGNAL(setSubdivision(bool)),&mandelbrotSet,SLOT(setSubdivision(bool)),Qt::QueuedConnection);
+    QObject::connect(this,SIGNAL(setAntialiasing(qint32,qint32,double)),&mandelbrotSet,SLOT(setAntialiasing(qint32,qint32,double)),Qt::QueuedConnection);
     QObject::connect(this,SIGNAL(setColorPalette(QImage)),&mandelbrotSet,SLOT(setColorPalette(QImage)),Qt::QueuedConnection);
+    QObject::connect(this,SIGNAL(setRenderFocus(qint32,qint32)),&mandelbrotSet,SLOT(setRenderFocus(qint32,qint32)),Qt::QueuedConnection);
+
+    //set up communication with the poster renderer
+    QObject::connect(this,SIGNAL(renderPoster(PosterRequest)),&posterRenderer,SLOT(render(PosterRequest)),Qt::QueuedConnection);
+    QObject::connect(&posterRenderer,SIGNAL(rowsWritten(int)),this,SLOT(receivePosterRows(int)),Qt::QueuedConnection);
+    QObject::connect(&posterRenderer,SIGNAL(errorCodeOut(int)),this,SLOT(receiveErrorCode(int)),Qt::QueuedConnection);
+    QObject::connect(&posterRenderer,SIGNAL(finished(int)),this,SLOT(receivePosterResult(int)),Qt::QueuedConnection);
 
     //set up delayedRenderTimer
     delayedRenderTimer.setSingleShot(true);
@@ -112,6 +104,11 @@ MandelbrotMainWindow::~MandelbrotMainWindow()
 }
 
 void MandelbrotMainWindow::renderImage()
+{
+    renderImage(ui->mandelbrotGraphicsView->mapFromGlobal(QCursor::pos()));
+}
+
+void MandelbrotMainWindow::renderImage(QPoint focus)
 {
     //show render progress bar, set upper limit to number of lines to render
     ui->renderProgressLabel->setVisible(true);
@@ -119,14 +116,25 @@ void MandelbrotMainWindow::renderImage()
     ui->renderProgressBar->setRange(0,ui->mandelbrotGraphicsView->height()*PASSES);
     ui->renderProgressBar->setValue(0);
 
-    //cancel ongoing render
-    mandelbrotSet.cancel();
+    //cancel ongoing and queued renders
+    requestedGeneration=mandelbrotSet.cancel();
 
-    //render Mandelbrot- or Julia-type images depending on current configuration
-    if(!currentConfig.julia)
-        emit renderMandelbrot(currentConfig.centerX,currentConfig.centerY,ui->mandelbrotGraphicsView->width(),ui->mandelbrotGraphicsView->height(),currentConfig.scale,currentConfig.nIterations,currentConfig.limit,PASSES);
+    requestedScale=currentConfig.scale;
+    requestedSize=ui->mandelbrotGraphicsView->size();
+    if(ui->mandelbrotGraphicsView->rect().contains(focus))
+        emit setRenderFocus(focus.x(),focus.y());
     else
-        emit renderJulia(currentConfig.centerX,currentConfig.centerY,ui->mandelbrotGraphicsView->width(),ui->mandelbrotGraphicsView->height(),currentConfig.scale,currentConfig.nIterations,currentConfig.limit,PASSES,currentConfig.juliaRe,currentConfig.juliaIm);
+        emit setRenderFocus(-1,-1);
+    //render Mandelbrot- or Julia-type images depending on current configuration, the center is passed at full precision for deep zooms
+    RenderRequest request={currentConfig.centerX,currentConfig.centerY,ui->mandelbrotGraphicsView->width(),ui->mandelbrotGraphicsView->height(),currentConfig.scale,currentConfig.nIterations,currentConfig.limit,PASSES,currentConfig.julia,currentConfig.juliaRe,currentConfig.juliaIm,false,requestedGeneration};
+    emit render(request);
+}
+
+void MandelbrotMainWindow::recolorImage()
+{
+    //cancel ongoing render, only the palette stage is run again on the iteration results of the last one
+    requestedGeneration=mandelbrotSet.cancel();
+    emit recolor(requestedGeneration);
 }
 
 /*
@@ -139,14 +147,51 @@ void MandelbrotMainWindow::renderImage()
  *
  */
 
-void MandelbrotMainWindow::updateImage(QImage image)
+void MandelbrotMainWindow::updateImage(QImage image,qint32 generation)
 {
+    //frames of superseded renders may still be queued
+    if(generation!=requestedGeneration)
+        return;
+    tileGeneration=generation;
     mandelbrotPixmap=QPixmap::fromImage(image);
+    resetPixmapItem();
+    mandelbrotPixmapItem.setPixmap(mandelbrotPixmap);
+    ui->mandelbrotGraphicsView->update();
+}
+
+void MandelbrotMainWindow::updateTile(QImage tile,qint32 x,qint32 y,qint32 generation)
+{
+    if(generation!=requestedGeneration)
+        return;
+    if(tileGeneration!=generation)
+    {
+        //first tile of a render, keep showing the last image dragged or scaled as it is until the tiles cover it
+        tileGeneration=generation;
+        QPixmap pixmap(requestedSize);
+        pixmap.fill(Qt::black);
+        QPainter painter(&pixmap);
+        painter.setTransform(mandelbrotPixmapItem.sceneTransform());
+        painter.drawPixmap(mandelbrotPixmapItem.offset(),mandelbrotPixmapItem.pixmap());
+        painter.end();
+        mandelbrotPixmap=pixmap;
+        resetPixmapItem();
+    }
+    //the item shares the pixmap, painting would copy all of it for every tile otherwise
+    mandelbrotPixmapItem.setPixmap(QPixmap());
+    QPainter painter(&mandelbrotPixmap);
+    painter.drawImage(x,y,tile);
+    painter.end();
+    mandelbrotPixmapItem.setPixmap(mandelbrotPixmap);
+    ui->mandelbrotGraphicsView->update();
+}
+
+void MandelbrotMainWindow::resetPixmapItem()
+{
     mandelbrotPixmapItem.setPos(0,0);
     mandelbrotPixmapItem.setOffset(0,0);
     preDragOffset=QPoint(0,0);
-    mandelbrotPixmapItem.setPixmap(mandelbrotPixmap);
-    ui->mandelbrotGraphicsView->update();
+    mandelbrotPixmapItem.setScale(1.);
+    imageScale=requestedScale;
 }
 
 void MandelbrotMainWindow::receiveErrorCode(qint32 errorCode)
@@ -170,6 +215,81 @@ void MandelbrotMainWindow::receiveErrorCode(qint32 errorCode)
     ui->statusBar->showMessage(message,5000);
 }
 
+void MandelbrotMainWindow::receivePrecision(QString precision)
+{
+    //append number type used by the render to the error message shown before
+    ui->statusBar->showMessage(ui->statusBar->currentMessage()+" Precision: "+precision+".",5000);
+}
+
+void MandelbrotMainWindow::receiveSeriesSkip(qint32 iterations)
+{
+    ui->statusBar->showMessage(ui->statusBar->currentMessage()+" Series approximation skipped "+QString::number(iterations)+" iterations per pixel.",5000);
+}
+
+void MandelbrotMainWindow::receivePosterRows(qint32 rows)
+{
+    ui->statusBar->showMessage(QString("Poster: %1 of %2 rows written.").arg(rows).arg(posterHeight));
+}
+
+void MandelbrotMainWindow::receivePosterResult(qint32 result)
+{
+    posterRunning=false;
+    ui->savePosterPushButton->setText("Save poster");
+    switch(result)
+    {
+    case PosterRenderer::POSTER_COMPLETE:
+        ui->statusBar->showMessage("Poster complete.",5000);
+        break;
+    case PosterRenderer::POSTER_CANCELED:
+        ui->statusBar->showMessage("Poster canceled, saving it to the same file again continues it.",5000);
+        break;
+    case PosterRenderer::POSTER_WRITE_ERROR:
+        ui->statusBar->showMessage("Error writing poster.",5000);
+        break;
+    default:
+        break;
+    }
+}
+
+void MandelbrotMainWindow::receiveTileCacheStats(qint32 hits, qint32 misses)
+{
+    ui->statusBar->showMessage(ui->statusBar->currentMessage()+" Tile cache: "+QString::number(hits)+" hits, "+QString::number(misses)+" misses.",5000);
+}
+
+void MandelbrotMainWindow::receiveComputedPixels(double percent)
+{
+    ui->statusBar->showMessage(ui->statusBar->currentMessage()+" Computed "+QString::number(percent,'f',1)+"% of pixels.",5000);
+}
+
+void MandelbrotMainWindow::receiveRenderStats(RenderStats stats)
+{
+    //the summary of the last pass is appended to the messages of the render, every pass is logged
+    if(stats.pass==stats.nPasses-1)
+    {
+        qint64 pixels=stats.escapedPixels+stats.interiorPixels;
+        ui->statusBar->showMessage(ui->statusBar->currentMessage()+
+                                   QString(" Rendered in %1 s, %2 iterations, %3% escaped; iterating %4 s, coloring %5 s on %6 threads.")
+                                   .arg(stats.seconds,0,'f',3).arg((double)stats.iterations,0,'g',3).arg(pixels?100.*stats.escapedPixels/pixels:0.,0,'f',1)
+                                   .arg(stats.iterationSeconds,0,'f',3).arg(stats.paletteSeconds,0,'f',3).arg(stats.threads),5000);
+    }
+    if(!ui->logStatsCheckBox->isChecked())
+        return;
+    QFile file(STATS_LOG_FILE_NAME);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        ui->statusBar->showMessage("Error writing "+STATS_LOG_FILE_NAME+".",5000);
+        return;
+    }
+    //one tab separated line per pass, the histogram is the last field
+    QTextStream out(&file);
+    out<<QDateTime::currentDateTime().toString(Qt::ISODate)<<'\t'<<currentConfigName<<'\t'<<stats.pass+1<<'/'<<stats.nPasses<<'\t'
+      <<stats.nIterations<<'\t'<<stats.threads<<'\t'<<stats.seconds<<'\t'<<stats.iterationSeconds<<'\t'<<stats.paletteSeconds<<'\t'
+      <<stats.iterations<<'\t'<<stats.escapedPixels<<'\t'<<stats.interiorPixels<<'\t';
+    for(size_t i=0;i<stats.histogram.size();++i)
+        out<<(i?" ":"")<<stats.histogram[i];
+    out<<'\n';
+}
+
 /*
  *
  *
@@ -254,7 +374,7 @@ bool MandelbrotMainWindow::eventFilter(QObject *target, QEvent *e)
             }
             QPoint p=QPoint(ui->mandelbrotGraphicsView->width()/2,ui->mandelbrotGraphicsView->height()/2);
             p=event->pos()-p;
-            ui->statusBar->showMessage("("+QString::number(currentConfig.scale*p.x()+currentConfig.centerX)+","+QString::number(currentConfig.scale*p.y()+currentConfig.centerY)+")",5000);
+            ui->statusBar->showMessage("("+coordinateToString(currentConfig.centerX+currentConfig.scale*p.x(),currentConfig.scale)+","+coordinateToString(currentConfig.centerY+currentConfig.scale*p.y(),currentConfig.scale)+")",5000);
             break;
         }
         case QEvent::MouseButtonRelease:
@@ -294,8 +414,8 @@ bool MandelbrotMainWindow::eventFilter(QObject *target, QEvent *e)
                         p=event->pos()-p;
                         currentConfig.julia=true;
                         //order of assignments is important, since centerX, centerY, scale will be changed
-                        currentConfig.juliaIm=currentConfig.centerY+currentConfig.scale*p.y();
-                        currentConfig.juliaRe=currentConfig.centerX+currentConfig.scale*p.x();
+                        currentConfig.juliaIm=(currentConfig.centerY+currentConfig.scale*p.y()).toDouble();
+                        currentConfig.juliaRe=(currentConfig.centerX+currentConfig.scale*p.x()).toDouble();
                         currentConfig.centerX=0;
                         currentConfig.centerY=0;
                         currentConfig.limit=DEFAULT_LIMIT;
@@ -326,8 +446,9 @@ bool MandelbrotMainWindow::eventFilter(QObject *target, QEvent *e)
         {
             //zoom in and out
             QWheelEvent* event=(QWheelEvent*)e;
-            currentConfig.scale*=pow(16.,-(double)event->angleDelta().y()/(8.*360.));
-            ui->scaleLineEdit->setText(QString::number(currentConfig.scale));
+            currentConfig.scale=qMax(currentConfig.scale*pow(16.,-(double)event->angleDelta().y()/(8.*360.)),MIN_SCALE);
+            ui->scaleLineEdit->setText(currentConfig.scale.toString());
+            previewZoom();
             delayedRenderTimer.start(200);
             return false;
             break;
@@ -338,14 +459,16 @@ bool MandelbrotMainWindow::eventFilter(QObject *target, QEvent *e)
             QKeyEvent* event=(QKeyEvent*)e;
             if(event->key()==Qt::Key_Plus)
             {
-                currentConfig.scale/=2.;
-                ui->scaleLineEdit->setText(QString::number(currentConfig.scale));
+                currentConfig.scale=qMax(currentConfig.scale/2.,MIN_SCALE);
+                ui->scaleLineEdit->setText(currentConfig.scale.toString());
+                previewZoom();
                 renderImage();
             }
             else if(event->key()==Qt::Key_Minus)
             {
-                currentConfig.scale*=2.;
-                ui->scaleLineEdit->setText(QString::number(currentConfig.scale));
+                currentConfig.scale=currentConfig.scale*2.;
+                ui->scaleLineEdit->setText(currentConfig.scale.toString());
+                previewZoom();
                 renderImage();
             }
             break;
@@ -402,7 +525,10 @@ bool MandelbrotMainWindow::eventFilter(QObject *target, QEvent *e)
 void MandelbrotMainWindow::closeEvent(QCloseEvent *event)
 {
     Q_UNUSED(event)
-    //cleanup
+    //cleanup, an unfinished poster keeps its checkpoint and continues when saved again
+    posterRenderer.cancel();
+    posterThread.quit();
+    posterThread.wait();
     workerThread.quit();
     mandelbrotScene.removeItem(&mandelbrotPixmapItem);
 }
@@ -419,25 +545,36 @@ void MandelbrotMainWindow::resizeEvent(QResizeEvent *e)
 void MandelbrotMainWindow::zoomToRect(QRectF rect)
 {
     //change current config according to zoom rectangle
-    currentConfig.centerX+=currentConfig.scale*(rect.x()+rect.width()/2-ui->mandelbrotGraphicsView->width()/2);
-    currentConfig.centerY+=currentConfig.scale*(rect.y()+rect.height()/2-ui->mandelbrotGraphicsView->height()/2);
-    currentConfig.scale*=rect.width()/ui->mandelbrotGraphicsView->width();
+    currentConfig.centerX+=BigFixed(currentConfig.scale*(rect.x()+rect.width()/2-ui->mandelbrotGraphicsView->width()/2));
+    currentConfig.centerY+=BigFixed(currentConfig.scale*(rect.y()+rect.height()/2-ui->mandelbrotGraphicsView->height()/2));
+    currentConfig.scale=qMax(currentConfig.scale*rect.width()/ui->mandelbrotGraphicsView->width(),MIN_SCALE);
     //update UI
-    ui->xLineEdit->setText(QString::number(currentConfig.centerX));
-    ui->yLineEdit->setText(QString::number(currentConfig.centerY));
-    ui->scaleLineEdit->setText(QString::number(currentConfig.scale));
-    //render selected area
-    renderImage();
+    ui->xLineEdit->setText(coordinateToString(currentConfig.centerX,currentConfig.scale));
+    ui->yLineEdit->setText(coordinateToString(currentConfig.centerY,currentConfig.scale));
+    ui->scaleLineEdit->setText(currentConfig.scale.toString());
+    //render selected area, starting at its center
+    renderImage(QPoint(-1,-1));
+}
+
+//shows the last image scaled about the view center to the current scale until the render of the new scale arrives
+void MandelbrotMainWindow::previewZoom()
+{
+    if(imageScale<=0.)
+        return;
+    QPointF center(ui->mandelbrotGraphicsView->width()/2,ui->mandelbrotGraphicsView->height()/2);
+    mandelbrotPixmapItem.setTransformOriginPoint(center-mandelbrotPixmapItem.pos());
+    mandelbrotPixmapItem.setScale((double)(imageScale/currentConfig.scale));
+    ui->mandelbrotGraphicsView->update();
 }
 
 void MandelbrotMainWindow::moveByOffset(QPoint offset)
 {
     //change current config according to offset
-    currentConfig.centerX-=currentConfig.scale*offset.x();
-    currentConfig.centerY-=currentConfig.scale*offset.y();
+    currentConfig.centerX-=BigFixed(currentConfig.scale*offset.x());
+    currentConfig.centerY-=BigFixed(currentConfig.scale*offset.y());
     //update UI
-    ui->xLineEdit->setText(QString::number(currentConfig.centerX));
-    ui->yLineEdit->setText(QString::number(currentConfig.centerY));
+    ui->xLineEdit->setText(coordinateToString(currentConfig.centerX,currentConfig.scale));
+    ui->yLineEdit->setText(coordinateToString(currentConfig.centerY,currentConfig.scale));
     //render new area
     renderImage();
 }
@@ -515,10 +652,14 @@ void MandelbrotMainWindow::on_mandelbrotRadioButton_toggled(bool checked)
 
 void MandelbrotMainWindow::on_applyPushButton_clicked()
 {
-    //user wants to apply the config as set and displayed on the UI
+    //user wants to apply the config as set and displayed on the UI, coloring changes don't need iterating again
+    MandelbrotConfig previousConfig=currentConfig;
     setConfigToUIContents();
     applyCurrentConfig();
-    renderImage();
+    if(previousConfig.sameView(currentConfig))
+        recolorImage();
+    else
+        renderImage();
     ui->applyPushButton->setEnabled(false);
 }
 
@@ -530,6 +671,34 @@ void MandelbrotMainWindow::on_saveImagePushButton_clicked()
         mandelbrotPixmapItem.pixmap().save(fileName);
 }
 
+void MandelbrotMainWindow::on_savePosterPushButton_clicked()
+{
+    //the button cancels a poster in progress
+    if(posterRunning)
+    {
+        posterRenderer.cancel();
+        return;
+    }
+    //user picks a size, the poster shows the area of the render area at the resolution of its width
+    bool ok;
+    qint32 width=QInputDialog::getInt(this,"Save poster","Width in pixels:",ui->mandelbrotGraphicsView->width()*10,1,1000000,1,&ok);
+    if(!ok)
+        return;
+    qint32 height=QInputDialog::getInt(this,"Save poster","Height in pixels:",
+                                       (qint32)((qint64)width*ui->mandelbrotGraphicsView->height()/ui->mandelbrotGraphicsView->width()),1,1000000,1,&ok);
+    if(!ok)
+        return;
+    QString fileName=QFileDialog::getSaveFileName(0,"Save poster","./images","PPM images (*.ppm)");
+    if(fileName=="")
+        return;
+    PosterRequest request={currentConfig,currentColorPalette,width,height,fileName,PosterRenderer::DEFAULT_MEMORY_BUDGET};
+    request.config.scale=currentConfig.scale*ui->mandelbrotGraphicsView->width()/width;
+    posterRunning=true;
+    posterHeight=height;
+    ui->savePosterPushButton->setText("Cancel poster");
+    emit renderPoster(request);
+}
+
 
 /*
  *
@@ -603,68 +772,23 @@ void MandelbrotMainWindow::deleteCurrentConfig()
 void MandelbrotMainWindow::readConfigs()
 {
     //read config set from config.cfg, fill combo box with configurations
-    QFile file("config.cfg");
-    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    ConfigList configs;
+    if(!readConfigFile("config.cfg",configs))
         return;
     configurations.clear();
-    QTextStream in(&file);
     ui->nameComboBox->clear();
-    QString name;
-    MandelbrotConfig config;
-    while(!in.atEnd())
-    {
-        name=in.readLine();
-        config.formula=in.readLine();
-        config.limit=in.readLine().toDouble();
-        config.centerX=in.readLine().toDouble();
-        config.centerY=in.readLine().toDouble();
-        config.scale=in.readLine().toDouble();
-        config.nIterations=in.readLine().toInt();
-        config.colorPaletteFileName=in.readLine();
-        config.paletteFormulaX=in.readLine();
-        config.col0interior=!!in.readLine().toInt();
-        config.paletteFormulaY=in.readLine();
-        config.row0interior=!!in.readLine().toInt();
-        config.julia=!!in.readLine().toInt();
-        config.juliaRe=in.readLine().toDouble();
-        config.juliaIm=in.readLine().toDouble();
-        if(configurations.find(name)==configurations.end())
+    for(size_t i=0;i<configs.size();++i)
+        if(configurations.find(configs[i].first)==configurations.end())
         {
-            configurations[name]=config;
-            ui->nameComboBox->addItem(name);
+            configurations[configs[i].first]=configs[i].second;
+            ui->nameComboBox->addItem(configs[i].first);
         }
-    }
 }
 
 void MandelbrotMainWindow::writeConfigs()
 {
     //write config set to config.cfg
-    QFile file("config.cfg");
-    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
-        return;
-    std::map<QString,MandelbrotConfig>::iterator it=configurations.begin();
-    QTextStream out(&file);
-    std::pair<QString,MandelbrotConfig> p;
-    while(it!=configurations.end())
-    {
-        p=*it;
-        out<<p.first<<"\n";
-        out<<p.second.formula<<"\n";
-        out<<QString::number(p.second.limit)<<"\n";
-        out<<QString::number(p.second.centerX)<<"\n";
-        out<<QString::number(p.second.centerY)<<"\n";
-        out<<QString::number(p.second.scale)<<"\n";
-        out<<QString::number(p.second.nIterations)<<"\n";
-        out<<p.second.colorPaletteFileName<<"\n";
-        out<<p.second.paletteFormulaX<<"\n";
-        out<<QString::number((int)p.second.col0interior)<<"\n";
-        out<<p.second.paletteFormulaY<<"\n";
-        out<<QString::number((int)p.second.row0interior)<<"\n";
-        out<<QString::number((int)p.second.julia)<<"\n";
-        out<<QString::number(p.second.juliaRe)<<"\n";
-        out<<QString::number(p.second.juliaIm)<<"\n";
-        ++it;
-    }
+    writeConfigFile("config.cfg",configurations);
 }
 
 void MandelbrotMainWindow::updateConfigUI()
@@ -672,9 +796,9 @@ void MandelbrotMainWindow::updateConfigUI()
     //update UI to reflect current config
     ui->formulaLineEdit->setText(currentConfig.formula);
     ui->limitLineEdit->setText(QString::number(currentConfig.limit));
-    ui->xLineEdit->setText(QString::number(currentConfig.centerX));
-    ui->yLineEdit->setText(QString::number(currentConfig.centerY));
-    ui->scaleLineEdit->setText(QString::number(currentConfig.scale));
+    ui->xLineEdit->setText(coordinateToString(currentConfig.centerX,currentConfig.scale));
+    ui->yLineEdit->setText(coordinateToString(currentConfig.centerY,currentConfig.scale));
+    ui->scaleLineEdit->setText(currentConfig.scale.toString());
     ui->iterationsLineEdit->setText(QString::number(currentConfig.nIterations));
     ui->paletteFormulaXLineEdit->setText(currentConfig.paletteFormulaX);
     ui->col0CheckBox->setChecked(currentConfig.col0interior);
@@ -703,13 +827,15 @@ qint32 MandelbrotMainWindow::setConfigToUIContents()
     currentConfig.limit=ui->limitLineEdit->text().toDouble(&ok);
     errorCode<<=1;
     errorCode|=(int)ok;
-    currentConfig.centerX=ui->xLineEdit->text().toDouble(&ok);
+    currentConfig.centerX=BigFixed::fromString(ui->xLineEdit->text(),&ok);
     errorCode<<=1;
     errorCode|=(int)ok;
-    currentConfig.centerY=ui->yLineEdit->text().toDouble(&ok);
+    currentConfig.centerY=BigFixed::fromString(ui->yLineEdit->text(),&ok);
     errorCode<<=1;
     errorCode|=(int)ok;
-    currentConfig.scale=ui->scaleLineEdit->text().toDouble(&ok);
+    currentConfig.scale=FloatExp::fromString(ui->scaleLineEdit->text(),&ok);
+    ok=ok && currentConfig.scale>0.;
+    currentConfig.scale=qMax(currentConfig.scale,MIN_SCALE);
     errorCode<<=1;
     errorCode|=(int)ok;
     currentConfig.nIterations=ui->iterationsLineEdit->text().toInt(&ok);
@@ -731,35 +857,7 @@ qint32 MandelbrotMainWindow::setConfigToUIContents()
 
 void MandelbrotMainWindow::generateDefaultPalette()
 {
-    static const qint32 width=256;
-    static const qint32 ncolors=8;
-    defaultPalette=QImage(width,1,QImage::Format_RGB32);
-    QColor colors[]=
-    {
-        QColor(0,0,100),
-        QColor(0,0,255),
-        QColor(255,255,255),
-        QColor(0,0,255),
-        QColor(255,255,255),
-        QColor(240,70,0),
-        QColor(255,255,70),
-        QColor(255,255,255)
-    };
-    ((quint32*)defaultPalette.scanLine(0))[0]=(quint32)qRgb(0,0,0);
-    double seglength=(double)width/(double)(ncolors-1);
-    qint32 seg;
-    double pos;
-    for(qint32 i=1;i<width;++i)
-    {
-        seg=i*(ncolors-1)/width;
-        pos=((double)i-seg*seglength)/seglength;
-        ((quint32*)defaultPalette.scanLine(0))[i]=(quint32)qRgb(
-                colors[seg].red()*(1-pos)+colors[seg+1].red()*pos,
-                colors[seg].green()*(1-pos)+colors[seg+1].green()*pos,
-                colors[seg].blue()*(1-pos)+colors[seg+1].blue()*pos
-                    );
-
-    }
+    defaultPalette=defaultColorPalette();
     defaultPalette.save("./palettes/default.jpg");
 }
 
@@ -833,6 +931,21 @@ void MandelbrotMainWindow::on_juliaYLineEdit_textEdited(const QString &)
     ui->applyPushButton->setEnabled(true);
 }
 
+void MandelbrotMainWindow::on_subdivisionCheckBox_clicked()
+{
+    //render option independent of the config, takes effect immediately
+    emit setSubdivision(ui->subdivisionCheckBox->isChecked());
+    renderImage();
+}
+
+void MandelbrotMainWindow::on_antialiasCheckBox_clicked()
+{
+    //render option independent of the config, takes effect immediately
+    emit setAntialiasing(ui->antialiasCheckBox->isChecked()?MandelbrotSet::DEFAULT_ANTIALIAS_SAMPLES:1,
+                         MandelbrotSet::DEFAULT_ANTIALIAS_THRESHOLD,MandelbrotSet::DEFAULT_ANTIALIAS_BUDGET);
+    renderImage();
+}
+
 void MandelbrotMainWindow::on_renderProgressBar_valueChanged(qint32 value)
 {
     if(value==ui->renderProgressBar->maximum())
@@ -10,6 +10,8 @@
 #include <QMouseEvent>
 #include <QFileDialog>
 #include "mandelbrotset.h"
+#include "configio.h"
+#include "posterrenderer.h"
 #include "MathParser/mathparser.h"
 #include <complex>
 #include <map>
@@ -29,8 +31,9 @@ public:
     ~MandelbrotMainWindow();
 signals:
     //signals for rendering images in another thread
-    void renderMandelbrot(double xCenter,double yCenter, qint32 width, qint32 height, double scale, qint32 nIterations, double limit, qint32 nPasses);
-    void renderJulia(double xCenter,double yCenter, qint32 width, qint32 height, double scale, qint32 nIterations, double limit, qint32 nPasses, double cRe, double cIm);
+    void render(RenderRequest request);
+    void recolor(qint32 generation);
+    void renderPoster(PosterRequest request);
     //signals for changing settings of the MandelbrotSet instance which takes care of calculation and rendering
     void parseFormula(QString formula);
     void parsePaletteXFormula(QString formula);
@@ -38,10 +41,22 @@ signals:
     void setColorPalette(QImage palette);
     void setCol0Interior(bool b);
     void setRow0Interior(bool b);
+    void setSubdivision(bool b);
+    void setAntialiasing(qint32 samples,qint32 threshold,double budget);
+    void setRenderFocus(qint32 x,qint32 y);
 public slots:
     //processing of incoming signals from worker thread
-    void updateImage(QImage image);
+    void updateImage(QImage image,qint32 generation);
+    void updateTile(QImage tile,qint32 x,qint32 y,qint32 generation);
     void receiveErrorCode(qint32 errorCode);
+    void receivePrecision(QString precision);
+    void receiveSeriesSkip(qint32 iterations);
+    void receiveComputedPixels(double percent);
+    void receiveRenderStats(RenderStats stats);
+    void receiveTileCacheStats(qint32 hits,qint32 misses);
+    //processing of incoming signals from poster thread
+    void receivePosterRows(qint32 rows);
+    void receivePosterResult(qint32 result);
 protected:
     virtual void resizeEvent(QResizeEvent *e);
     //event filter to intercept mouse events on the render area
@@ -59,6 +74,7 @@ private slots:
     void on_mandelbrotRadioButton_toggled(bool checked);
     void on_applyPushButton_clicked();
     void on_saveImagePushButton_clicked();
+    void on_savePosterPushButton_clicked();
     void on_formulaLineEdit_textEdited(const QString &);
     void on_limitLineEdit_textEdited(const QString &);
     void on_xLineEdit_textEdited(const QString &);
@@ -73,11 +89,14 @@ private slots:
     void on_juliaRadioButton_clicked();
     void on_juliaXLineEdit_textEdited(const QString &);
     void on_juliaYLineEdit_textEdited(const QString &);
+    void on_subdivisionCheckBox_clicked();
+    void on_antialiasCheckBox_clicked();
     //progress bar slot
     void on_renderProgressBar_valueChanged(qint32 value);
 
-    //render image slot, sometimes called as normal member
+    //render image slot, sometimes called as normal member. renders outward from the mouse cursor if it's on the render area.
     void renderImage();
+    void recolorImage();
 
 
 private:
@@ -87,6 +106,14 @@ private:
     MandelbrotSet mandelbrotSet;
     QThread workerThread;
     static const qint32 PASSES;
+    //render statistics are appended to this file while the log check box is set
+    static const QString STATS_LOG_FILE_NAME;
+
+    //renders posters larger than memory band by band on a thread of its own, height is kept for progress messages
+    PosterRenderer posterRenderer;
+    QThread posterThread;
+    bool posterRunning;
+    qint32 posterHeight;
 
     //contents of render area
     QPixmap mandelbrotPixmap;
@@ -102,7 +129,18 @@ private:
     static const qint32 MIN_ZOOM_HEIGHT;
     static const qint32 MIN_DRAG_DISTANCE_SQUARED;
     void zoomToRect(QRectF rect);
+    void previewZoom();
+    //scale of the image shown and of the render last requested, images of earlier generations are dropped
+    FloatExp imageScale;
+    FloatExp requestedScale;
+    qint32 requestedGeneration;
     void moveByOffset(QPoint offset);
+    //tiles are drawn over the shown image, which is redrawn at the requested size as it appears once the first tile arrives
+    QSize requestedSize;
+    qint32 tileGeneration;
+    void resetPixmapItem();
+    //renders outward from the given point of the render area, the center if it's outside
+    void renderImage(QPoint focus);
 
     //set of configurations addressable by their name
     std::map<QString,MandelbrotConfig> configurations;
@@ -127,13 +165,6 @@ private:
     //update config to reflect UI contents, return an error code specifying which assignments went wrong
     qint32 setConfigToUIContents();
 
-    //default config
-    static const QString DEFAULT_CONFIG_NAME;
-    static const MandelbrotConfig DEFAULT_CONFIG;
-    //modified coloring formula to reduce banding
-    static const QString DEFAULT_CONFIG_SMOOTH_COLORING_NAME;
-    static const MandelbrotConfig DEFAULT_CONFIG_SMOOTH_COLORING;
-
     static const qint32 DEFAULT_ITERATIONS;
     static const double DEFAULT_SCALE;
     static const double DEFAULT_LIMIT;
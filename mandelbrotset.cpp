@@ -1,246 +1,1402 @@
 #include "mandelbrotset.h"
-#include <QMessageBox>
 #include <QColor>
-const qint32 REPORT_LINES_RENDERED=32;
+#include <QThread>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QMetaMethod>
+#include <QtMath>
+#include <cmath>
+#include <algorithm>
+const qint32 REPORT_LINES_RENDERED_MS=50;
+const qint32 MandelbrotSet::TILE_SIZE=64;
+//number of references tried per pass before remaining glitches are accepted
+const qint32 MandelbrotSet::MAX_REFERENCES=16;
+//rectangles of the subdivision mode this narrow are computed instead of split
+const qint32 MandelbrotSet::MIN_SUBDIVISION_SIZE=6;
+//pixels a worker anti-aliases at a time
+const qint32 MandelbrotSet::ANTIALIAS_CHUNK_SIZE=32;
+const qint32 MandelbrotSet::DEFAULT_ANTIALIAS_SAMPLES=16;
+const qint32 MandelbrotSet::DEFAULT_ANTIALIAS_THRESHOLD=24;
+const double MandelbrotSet::DEFAULT_ANTIALIAS_BUDGET=2.;
+const qint32 MandelbrotSet::HISTOGRAM_BINS=32;
+//iterations a worker runs between checks for cancellation, a single pixel may exceed them
+const qint32 MandelbrotSet::CANCEL_CHECK_ITERATIONS=1<<18;
+//iterations of an interpreted formula between checks for cancellation
+const qint32 MandelbrotSet::CANCEL_CHECK_ROUNDS=1024;
 
-inline QRgb colorInterp(QColor col[4],double x,double y)
+void PaletteVars::bind(MathEval<double> &eval)
 {
-    return qRgb(
-            (int)(((double)col[0].red()*(1.-x)+(double)col[1].red()*x)*(1.-y)+((double)col[2].red()*(1.-x)+(double)col[3].red()*x)*y),
-            (int)(((double)col[0].green()*(1.-x)+(double)col[1].green()*x)*(1.-y)+((double)col[2].green()*(1.-x)+(double)col[3].green()*x)*y),
-            (int)(((double)col[0].blue()*(1.-x)+(double)col[1].blue()*x)*(1.-y)+((double)col[2].blue()*(1.-x)+(double)col[3].blue()*x)*y)
-            );
+    //s=Re(z), t=Im(z) when iteration loop is done
+    s=eval.getVarPtr('s');
+    t=eval.getVarPtr('t');
+    //u=Re(c), v=Im(c) for Mandelbrot-type sets, initial value of z for Julia-type sets
+    u=eval.getVarPtr('u');
+    v=eval.getVarPtr('v');
+    //n=it (number of iterations before escape), m=nIterations (max. number of iterations), l=limit
+    n=eval.getVarPtr('n');
+    m=eval.getVarPtr('m');
+    l=eval.getVarPtr('l');
+    //w=paletteWidth, h=paletteHeight
+    w=eval.getVarPtr('w');
+    h=eval.getVarPtr('h');
+}
+
+//runs the tile loop of a single worker thread
+class MandelbrotSet::TileWorker : public QRunnable
+{
+public:
+    TileWorker(MandelbrotSet* set,FormulaContext* context): set_(set), context_(context) {}
+    void run() {set_->renderTiles(*context_);}
+private:
+    MandelbrotSet* set_;
+    FormulaContext* context_;
+};
+
+MandelbrotSet::MandelbrotSet(): QObject(), formulaRevision_(0), kernel_(0), floatKernel_(0), periodicKernel_(0), periodicFloatKernel_(0), doubleDoubleKernel_(0), batchKernel_(0), floatBatchKernel_(0), perturbationKernel_(0), floatExpPerturbationKernel_(0), polynomialPower_(0), errorCode_(0), col0Interior_(false), row0Interior_(false), subdivision_(false), antialiasSamples_(1), antialiasThreshold_(DEFAULT_ANTIALIAS_THRESHOLD), antialiasBudget_(DEFAULT_ANTIALIAS_BUDGET), focusX_(-1), focusY_(-1), paletteXIterationsOnly_(false), paletteYIterationsOnly_(false), generation_(0), renderGeneration_(0), complete_(false), recoloring_(false), antialiasing_(false), deliverTiles_(false)
+{
+    qRegisterMetaType<RenderRequest>("RenderRequest");
+    qRegisterMetaType<RenderStats>("RenderStats");
+    setThreadCount(QThread::idealThreadCount());
+}
+
+MandelbrotSet::~MandelbrotSet()
+{
+    pool_.waitForDone();
+    for(size_t i=0;i<contexts_.size();++i)
+        delete contexts_[i];
+}
+
+void MandelbrotSet::setThreadCount(qint32 n)
+{
+    n=(n<1)?1:n;
+    pool_.setMaxThreadCount(n);
+    while((qint32)contexts_.size()<n)
+        contexts_.push_back(new FormulaContext);
+    while((qint32)contexts_.size()>n)
+    {
+        delete contexts_.back();
+        contexts_.pop_back();
+    }
+}
+
+//the first context doubles as syntax checker, all contexts are parsed again before the next render
+void MandelbrotSet::parseFormula(QString str)
+{
+    formula_=str;
+    ++formulaRevision_;
+    contexts_[0]->parser.setString(str);
+    if(!contexts_[0]->parser.parse())
+    {
+        errorCode_|=FORMULA_PARSE_ERROR;
+        kernel_=floatKernel_=periodicKernel_=periodicFloatKernel_=0;
+        doubleDoubleKernel_=0;
+        batchKernel_=floatBatchKernel_=0;
+        batchProgram_=BatchProgram();
+        perturbationKernel_=floatExpPerturbationKernel_=0;
+        polynomialPower_=0;
+    }
+    else
+    {
+        errorCode_&=~FORMULA_PARSE_ERROR;
+        kernel_=selectEscapeKernel(str);
+        floatKernel_=selectFloatEscapeKernel(str);
+        periodicKernel_=selectEscapeKernel(str,true);
+        periodicFloatKernel_=selectFloatEscapeKernel(str,true);
+        doubleDoubleKernel_=selectDoubleDoubleKernel(str);
+        std::vector<qint32> exponents;
+        polynomialPower_=(recognizePolynomialFormula(str,exponents) && exponents.size()==1)?exponents[0]:0;
+        batchKernel_=(polynomialPower_==2)?selectQuadraticBatchKernel():0;
+        floatBatchKernel_=(polynomialPower_==2)?selectQuadraticFloatBatchKernel():0;
+        batchProgram_=BatchProgram();
+        if(batchMatchesInterpreter(str))
+            batchProgram_.compile(str);
+        perturbationKernel_=selectPerturbationKernel(polynomialPower_);
+        floatExpPerturbationKernel_=selectFloatExpPerturbationKernel(polynomialPower_);
+    }
+}
+
+bool MandelbrotSet::batchMatchesInterpreter(const QString &formula)
+{
+    //points inside and outside the unit circle, on the axes and off them
+    static const double PROBES[][4]={{0.,0.,-0.75,0.1},{0.3,-0.2,0.25,0.},{-1.1,0.7,-0.12,0.74},{2.,1.5,-2.,0.5},
+                                     {0.,-0.9,0.4,-0.3},{-0.5,0.,1.5,1.}};
+    BatchProgram program;
+    if(!program.compile(formula))
+        return false;
+    MathParser<std::complex<double> > parser;
+    MathEval<std::complex<double> > eval;
+    parser.setMathEval(&eval);
+    parser.setString(formula);
+    if(!parser.parse())
+        return false;
+    std::complex<double> *z=eval.getVarPtr('z'),*c=eval.getVarPtr('c');
+    *eval.getVarPtr('i')=std::complex<double>(0.0,1.0);
+    BatchEval<double> batch;
+    batch.setProgram(&program);
+    for(size_t p=0;p<sizeof(PROBES)/sizeof(PROBES[0]);++p)
+    {
+        const double* probe=PROBES[p];
+        *z=std::complex<double>(probe[0],probe[1]);
+        *c=std::complex<double>(probe[2],probe[3]);
+        eval.run();
+        std::complex<double> expected=eval.result();
+        batch.run(probe,probe+1,probe+2,probe+3,1);
+        std::complex<double> result(batch.resultRe()[0],batch.resultIm()[0]);
+        //both may overflow or hit a pole, otherwise they may only differ by rounding
+        bool finite=std::isfinite(expected.real()) && std::isfinite(expected.imag());
+        if(finite!=(std::isfinite(result.real()) && std::isfinite(result.imag())))
+            return false;
+        if(finite && std::abs(result-expected)>1e-9*qMax(1.,std::abs(expected)))
+            return false;
+    }
+    return true;
+}
+
+//true if a palette formula only depends on n and the per-render constants m, l, w and h, which allows coloring by table.
+//formulas the batch compiler doesn't understand are assumed to depend on everything.
+static bool dependsOnIterationsOnly(const QString& formula)
+{
+    BatchProgram program;
+    return program.compile(formula) && !program.usesVariable('s') && !program.usesVariable('t') &&
+            !program.usesVariable('u') && !program.usesVariable('v');
+}
+
+void MandelbrotSet::parsePaletteXFormula(QString str)
+{
+    paletteFormulaX_=str;
+    ++formulaRevision_;
+    paletteXIterationsOnly_=dependsOnIterationsOnly(str);
+    contexts_[0]->paletteXparser.setString(str);
+    if(!contexts_[0]->paletteXparser.parse())
+        errorCode_|=PALETTE_XFORMULA_PARSE_ERROR;
+    else
+        errorCode_&=~PALETTE_XFORMULA_PARSE_ERROR;
+}
+
+void MandelbrotSet::parsePaletteYFormula(QString str)
+{
+    paletteFormulaY_=str;
+    ++formulaRevision_;
+    paletteYIterationsOnly_=dependsOnIterationsOnly(str);
+    contexts_[0]->paletteYparser.setString(str);
+    if(!contexts_[0]->paletteYparser.parse())
+        errorCode_|=PALETTE_YFORMULA_PARSE_ERROR;
+    else
+        errorCode_&=~PALETTE_YFORMULA_PARSE_ERROR;
 }
 
 void MandelbrotSet::renderMandelbrot(double xCenter, double yCenter, qint32 width, qint32 height, double scale, qint32 nIterations, double limit, qint32 nPasses)
 {
-    if(--cancel_>0)
+    RenderRequest request={BigFixed(xCenter),BigFixed(yCenter),width,height,scale,nIterations,limit,nPasses,false,0.,0.,false,generation_.load()};
+    render(request);
+}
+
+void MandelbrotSet::renderJulia(double xCenter, double yCenter, qint32 width, qint32 height, double scale, qint32 nIterations, double limit, qint32 nPasses, double cRe, double cIm)
+{
+    RenderRequest request={BigFixed(xCenter),BigFixed(yCenter),width,height,scale,nIterations,limit,nPasses,true,cRe,cIm,false,generation_.load()};
+    render(request);
+}
+
+void MandelbrotSet::renderExponentialMap(double xCenter, double yCenter, qint32 width, qint32 height, double radius, qint32 nIterations, double limit, qint32 nPasses)
+{
+    RenderRequest request={BigFixed(xCenter),BigFixed(yCenter),width,height,radius,nIterations,limit,nPasses,false,0.,0.,true,generation_.load()};
+    render(request);
+}
+
+void MandelbrotSet::prepareContext(FormulaContext &context)
+{
+    if(context.revision!=formulaRevision_)
+    {
+        context.parser.setString(formula_);
+        context.parser.parse();
+        context.paletteXparser.setString(paletteFormulaX_);
+        context.paletteXparser.parse();
+        context.paletteYparser.setString(paletteFormulaY_);
+        context.paletteYparser.parse();
+        //z=z(n), c=std::complex<double>(x,y) with coordinates x and y on the complex plane corresponding to points of the image
+        context.c=context.eval.getVarPtr('c');
+        context.z=context.eval.getVarPtr('z');
+        context.paletteX.bind(context.paletteXeval);
+        context.paletteY.bind(context.paletteYeval);
+        if(batchProgram_.isValid())
+            context.batchEval.setProgram(&batchProgram_);
+        context.revision=formulaRevision_;
+    }
+    //imaginary unit i
+    (*context.eval.getVarPtr('i'))=std::complex<double>(0.0,1.0);
+    *context.paletteX.m=*context.paletteY.m=(double)request_.nIterations;
+    *context.paletteX.l=*context.paletteY.l=limit_;
+    *context.paletteX.w=*context.paletteY.w=(double)colorPalette_.width();
+    *context.paletteX.h=*context.paletteY.h=(double)colorPalette_.height();
+}
+
+void MandelbrotSet::render(RenderRequest request)
+{
+    //requests cancelled while they were queued are dropped
+    if(request.generation!=generation_.load())
         return;
-    else
-        cancel_=0;
+    renderGeneration_=request.generation;
     emit errorCodeOut(errorCode_);
     if(errorCode_)
         return;
-    qint32 halfWidth=width/2;
-    qint32 halfHeight=height/2;
-    QImage image(width,height,QImage::Format_RGB32);
-    qint32 paletteWidth=colorPalette_.width();
-    qint32 paletteHeight=colorPalette_.height();
-    quint32 *palette=reinterpret_cast<quint32*>(colorPalette_.scanLine(0));
-    //z=z(n), c=std::complex<double>(x,y) with coordinates x and y on the complex plane corresponding to points of the image
-    std::complex<double> *ec=eval_.getVarPtr('c'),*ez=eval_.getVarPtr('z');
-    //imaginary unit i
-    (*eval_.getVarPtr('i'))=std::complex<double>(0.0,1.0);
-    //s=Re(z), t=Im(z) when iteration loop is done
-    double *e1s=paletteXeval_.getVarPtr('s'), *e1t=paletteXeval_.getVarPtr('t');
-    double *e2s=paletteYeval_.getVarPtr('s'), *e2t=paletteYeval_.getVarPtr('t');
-    //u=Re(c), v=Im(c)
-    double *e1u=paletteXeval_.getVarPtr('u'), *e1v=paletteXeval_.getVarPtr('v');
-    double *e2u=paletteYeval_.getVarPtr('u'), *e2v=paletteYeval_.getVarPtr('v');
-    //n=it (number of iterations before escape), m=nIterations (max. number of iterations), l=limit
-    double *e1n=paletteXeval_.getVarPtr('n'), *e1m=paletteXeval_.getVarPtr('m'), *e1l=paletteXeval_.getVarPtr('l');
-    double *e2n=paletteYeval_.getVarPtr('n'), *e2m=paletteYeval_.getVarPtr('m'), *e2l=paletteXeval_.getVarPtr('l');
-    //w=paletteWidth, h=paletteHeight
-    double *e1w=paletteXeval_.getVarPtr('w'), *e1h=paletteXeval_.getVarPtr('h');
-    double *e2w=paletteYeval_.getVarPtr('w'), *e2h=paletteYeval_.getVarPtr('h');
-
-    *e1m=*e2m=(double)nIterations;
-    *e1l=*e2l=limit;
-    *e1w=*e2w=(double)paletteWidth;
-    *e1h=*e2h=(double)paletteHeight;
-    col0Interior_&=(paletteWidth>1);
-    row0Interior_&=(paletteHeight>1);
-    const qint32 upperLimit=(1<<(sizeof(int)*8-2));
-    for(qint32 pass=0;pass<nPasses;++pass)
-    {
-        qint32 nIt=nIterations>>(2*(nPasses-pass-1));
-        for(qint32 iy=0;iy<height;++iy)
-        {
-            quint32 *scanline=reinterpret_cast<quint32*>(image.scanLine(iy));
-            if(cancel_)
+    request.scale=qMax(request.scale,MIN_SCALE);
+    renderView(request);
+}
+
+//colors the last view again from the iteration buffer, which is all palette changes need. views which weren't
+//rendered completely are rendered again, as are subdivided ones whose filled areas depend on the colors.
+void MandelbrotSet::recolor(qint32 generation)
+{
+    if(generation!=generation_.load())
+        return;
+    renderGeneration_=generation;
+    emit errorCodeOut(errorCode_);
+    if(errorCode_ || iterations_.isEmpty())
+        return;
+    if(!complete_ || subdivision_ || iterations_.key.formula!=formula_)
+    {
+        renderView(request_);
+        return;
+    }
+    QImage image(request_.width,request_.height,QImage::Format_RGB32);
+    imageBits_=reinterpret_cast<quint32*>(image.bits());
+    imageStride_=image.bytesPerLine()/sizeof(quint32);
+    nIt_=request_.nIterations;
+    col0InteriorPass_=col0Interior_ && (colorPalette_.width()>1);
+    row0InteriorPass_=row0Interior_ && (colorPalette_.height()>1);
+    paletteSampler_.setPalette(colorPalette_,col0InteriorPass_,row0InteriorPass_);
+    for(size_t i=0;i<contexts_.size();++i)
+        prepareContext(*contexts_[i]);
+    preparePaletteTable();
+    deliverTiles_=isSignalConnected(QMetaMethod::fromSignal(&MandelbrotSet::tileOut));
+    recoloring_=true;
+    runTiles(0);
+    recoloring_=false;
+    if(cancelled() || !antialias())
+        return;
+    emit linesRendered(request_.height*request_.nPasses);
+    emit imageOut(image,renderGeneration_);
+}
+
+void MandelbrotSet::renderView(const RenderRequest &request)
+{
+    complete_=false;
+    request_=request;
+    xCenter_=request.xCenter.toDouble();
+    yCenter_=request.yCenter.toDouble();
+    selectPrecision();
+    expRadius_.clear();
+    expCos_.clear();
+    expSin_.clear();
+    if(request.exponential)
+    {
+        const double step=2*M_PI/request.width;
+        for(qint32 iy=0;iy<request.height;++iy)
+            expRadius_.push_back(offsetScale_*std::exp(-iy*step));
+        for(qint32 ix=0;ix<request.width;++ix)
+        {
+            expCos_.push_back(std::cos(ix*step));
+            expSin_.push_back(std::sin(ix*step));
+        }
+    }
+    //the reference orbit only holds escape limits up to maxReferenceLimit
+    limit_=deep_?qMin(request.limit,maxReferenceLimit(polynomialPower_)):request.limit;
+    QString precision=precisionName(precision_);
+    if(deep_ && limit_<request.limit)
+        precision+=QString(" (perturbation, limit lowered to %1)").arg(limit_);
+    else if(deep_)
+        precision+=" (perturbation)";
+    emit precisionOut(precision);
+    QImage image(request.width,request.height,QImage::Format_RGB32);
+    //continue from the previous render if view and formula are the same, unless fewer iterations are requested
+    IterationKey key={formula_,request.julia,request.cRe,request.cIm,request.limit,request.xCenter,request.yCenter,request.scale,request.width,request.height,precision_,deep_,request.exponential};
+    //a view moved by whole pixels or zoomed by an integer factor keeps the state of the pixels it shares with the previous one
+    qint32 dx,dy,zoomIn,zoomOut;
+    if(iterations_.isEmpty() || request.nIterations<iterations_.maxIterations)
+        iterations_.reset(key);
+    else if(iterations_.key!=key)
+    {
+        if(iterations_.key.panOffset(key,dx,dy))
+            iterations_.shift(key,dx,dy);
+        else if(iterations_.key.zoomFactor(key,zoomIn,zoomOut))
+            iterations_.zoom(key,zoomIn,zoomOut);
+        else
+            iterations_.reset(key);
+    }
+    col0InteriorPass_=col0Interior_ && (colorPalette_.width()>1);
+    row0InteriorPass_=row0Interior_ && (colorPalette_.height()>1);
+    paletteSampler_.setPalette(colorPalette_,col0InteriorPass_,row0InteriorPass_);
+    for(size_t i=0;i<contexts_.size();++i)
+    {
+        prepareContext(*contexts_[i]);
+        contexts_[i]->iterations=0;
+        contexts_[i]->iterationNsecs=0;
+        contexts_[i]->paletteNsecs=0;
+    }
+    preparePaletteTable();
+
+    //split image into tiles aligned to the grid of the tile cache, workers pick them up in the order of orderTiles().
+    //tiles at the image border may be partial, full ones are taken from the cache if it has them.
+    QString originX,originY;
+    qint64 firstX,firstY;
+    TileCache::gridPosition(request.xCenter,request.scale,request.width,originX,firstX);
+    TileCache::gridPosition(request.yCenter,request.scale,request.height,originY,firstY);
+    QString view=QString("%1|%2|%3|%4|%5|%6|%7|%8|%9|").arg(formula_).arg(request.julia).arg(request.cRe,0,'g',17).arg(request.cIm,0,'g',17)
+            .arg(request.limit,0,'g',17).arg(request.nIterations).arg(request.scale.toString(17)).arg(precision_).arg(deep_)+originX+"|"+originY;
+    qint32 x0=(qint32)(((-firstX)%TILE_SIZE+TILE_SIZE)%TILE_SIZE);
+    qint32 y0=(qint32)(((-firstY)%TILE_SIZE+TILE_SIZE)%TILE_SIZE);
+    tiles_.clear();
+    std::vector<TileCache::Key> missing;
+    qint32 cacheHits=0;
+    for(qint32 y=(y0?y0-TILE_SIZE:0);y<request.height;y+=TILE_SIZE)
+        for(qint32 x=(x0?x0-TILE_SIZE:0);x<request.width;x+=TILE_SIZE)
+        {
+            Tile tile={qMax(x,0),qMax(y,0),qMin(x+TILE_SIZE,request.width)-qMax(x,0),qMin(y+TILE_SIZE,request.height)-qMax(y,0)};
+            tiles_.push_back(tile);
+            //the cache grid is linear, so exponential maps aren't cached
+            if(tile.width!=TILE_SIZE || tile.height!=TILE_SIZE || request.exponential)
+                continue;
+            TileCache::Key tileKey={view,(firstX+x)/TILE_SIZE,(firstY+y)/TILE_SIZE};
+            const TileCache::Tile* cached=tileCache_.find(tileKey);
+            if(cached)
             {
-                --cancel_;
-                return;
+                loadTile(tile,*cached);
+                ++cacheHits;
             }
-            for(qint32 ix=0;ix<width;++ix)
-            {
-                double x=(ix-halfWidth)*scale+xCenter;
-                double y=(iy-halfHeight)*scale+yCenter;
+            else
+                missing.push_back(tileKey);
+        }
+    orderTiles();
+    deliverTiles_=isSignalConnected(QMetaMethod::fromSignal(&MandelbrotSet::tileOut));
 
-                *ec=std::complex<double>(x,y);
-                *ez=std::complex<double>(0,0);
-                qint32 it=0;
-                while(it<nIt && (ez->real()*ez->real()+ez->imag()*ez->imag())<=limit)
-                {
-                    eval_.run();
-                    *ez=eval_.result();
-                    ++it;
-                }
-                *e1s=*e2s=ez->real();
-                *e1t=*e2t=ez->imag();
-                *e1u=*e2u=ec->real();
-                *e1v=*e2v=ec->imag();
-                *e1n=*e2n=(double)it;
-                double xPal,yPal;
-                qint32 ixPal,iyPal;
-                paletteXeval_.run();
-                paletteYeval_.run();
-                xPal=paletteXeval_.result();
-                yPal=paletteYeval_.result();
-                xPal=(xPal<0 || xPal>upperLimit || xPal!=xPal)?0:xPal;
-                yPal=(yPal<0 || yPal>upperLimit || yPal!=yPal)?0:yPal;
-                ixPal=(int)xPal;
-                iyPal=(int)yPal;
-                qint32 index[4];
-                QColor col[4];
-                if(it==nIt)
-                {
-                    if(col0Interior_)
-                    {
-                        xPal=0;
-                        ixPal=0;
-                    }
-                    if(row0Interior_)
-                    {
-                        yPal=0;
-                        iyPal=0;
-                    }
-                    index[0]=ixPal%paletteWidth+(iyPal%paletteHeight)*paletteWidth;
-                    index[1]=(ixPal+1)%paletteWidth+(iyPal%paletteHeight)*paletteWidth;
-                    index[2]=ixPal%paletteWidth+((iyPal+1)%paletteHeight)*paletteWidth;
-                    index[3]=(ixPal+1)%paletteWidth+((iyPal+1)%paletteHeight)*paletteWidth;
-                }
-                else
+    qint32 seriesSkip=0;
+    qint32 pixelsComputed=0;
+    QElapsedTimer passTimer;
+    for(qint32 pass=0;pass<request.nPasses;++pass)
+    {
+        passTimer.start();
+        nIt_=request.nIterations>>(2*(request.nPasses-pass-1));
+        //passes the iteration buffer already covers are skipped, the last pass is always run to color the image.
+        //skipped passes report no iterations.
+        if(nIt_<=iterations_.completedIterations && pass<request.nPasses-1)
+        {
+            emit linesRendered(request.height*(pass+1));
+            emit statsOut(passStats(pass,passTimer.nsecsElapsed()*1e-9));
+            continue;
+        }
+        iterations_.maxIterations=qMax(iterations_.maxIterations,nIt_);
+        //bits() detaches the image from copies handed out in earlier passes, so call it before workers start writing
+        imageBits_=reinterpret_cast<quint32*>(image.bits());
+        imageStride_=image.bytesPerLine()/sizeof(quint32);
+        if(deep_)
+        {
+            //the innermost row of an exponential map is closest to its center
+            if(request.exponential)
+                computeReference(0,request.height-1);
+            else
+                computeReference(request.width/2,request.height/2);
+            computeSeries();
+            seriesSkip=series_.skip;
+        }
+        runTiles(request.height*pass);
+        pixelsComputed=pixelsComputed_.load();
+        //render glitched pixels again, each time using one of them as the new reference
+        qint32 x,y;
+        for(qint32 i=0;deep_ && i<MAX_REFERENCES && !cancelled() && findGlitchedPixel(x,y);++i)
+        {
+            computeReference(x,y);
+            series_.skip=0;
+            runTiles(request.height*pass);
+        }
+        if(cancelled())
+            return;
+        //filled pixels may lag behind, so subdivided passes don't count as completed
+        if(!subdivision_)
+            iterations_.completedIterations=qMax(iterations_.completedIterations,nIt_);
+        emit linesRendered(request.height*(pass+1));
+        emit imageOut(image,renderGeneration_);
+        if(pass<request.nPasses-1)
+            emit statsOut(passStats(pass,passTimer.nsecsElapsed()*1e-9));
+    }
+    complete_=true;
+    //full tiles which weren't in the cache are stored once all passes are done, filled pixels stay marked as such
+    for(size_t i=0;i<missing.size();++i)
+    {
+        Tile tile={(qint32)(missing[i].x*TILE_SIZE-firstX),(qint32)(missing[i].y*TILE_SIZE-firstY),TILE_SIZE,TILE_SIZE};
+        storeTile(tile,missing[i]);
+    }
+    emit tileCacheOut(cacheHits,(qint32)missing.size());
+    if(deep_)
+        emit seriesSkipOut(seriesSkip);
+    if(subdivision_)
+        emit computedPixelsOut(100.*pixelsComputed/((double)request.width*request.height));
+    if(antialiasSamples_>1)
+    {
+        if(!antialias())
+            return;
+        emit imageOut(image,renderGeneration_);
+    }
+    emit statsOut(passStats(request.nPasses-1,passTimer.nsecsElapsed()*1e-9));
+}
+
+RenderStats MandelbrotSet::passStats(qint32 pass, double seconds)
+{
+    const IterationBuffer& buffer=iterations_;
+    RenderStats stats={pass,request_.nPasses,(qint32)contexts_.size(),nIt_,0,0,0,std::vector<qint64>(HISTOGRAM_BINS,0),seconds,0.,0.};
+    for(size_t i=0;i<contexts_.size();++i)
+    {
+        FormulaContext& context=*contexts_[i];
+        stats.iterations+=context.iterations;
+        stats.iterationSeconds+=context.iterationNsecs*1e-9;
+        stats.paletteSeconds+=context.paletteNsecs*1e-9;
+        context.iterations=context.iterationNsecs=context.paletteNsecs=0;
+    }
+    for(size_t p=0;p<buffer.status.size();++p)
+    {
+        //pixels of a skipped pass which escape beyond its limit count as interior of that pass
+        if(!buffer.escaped(p) || buffer.it[p]>nIt_)
+        {
+            ++stats.interiorPixels;
+            continue;
+        }
+        ++stats.escapedPixels;
+        qint32 it=qMax(0,buffer.it[p]);
+        ++stats.histogram[(size_t)((qint64)it*HISTOGRAM_BINS/((qint64)nIt_+1))];
+    }
+    return stats;
+}
+
+//picks the cheapest number type resolving adjacent pixels of the current request. Below double precision
+//perturbation is preferred, double-double is used for polynomial formulas perturbation doesn't support.
+void MandelbrotSet::selectPrecision()
+{
+    const RenderRequest& r=request_;
+    double spacing=(double)(pixelSpacing()/qMax(1.,qMax(qAbs(xCenter_),qAbs(yCenter_))));
+    deep_=false;
+    if(spacing>=FLOAT_MIN_SPACING && (floatBatchKernel_ || floatKernel_))
+        precision_=PRECISION_FLOAT;
+    else if(spacing>=DOUBLE_MIN_SPACING)
+        precision_=PRECISION_DOUBLE;
+    else if(perturbationKernel_)
+    {
+        deep_=true;
+        precision_=(pixelSpacing()<FLOATEXP_MAX_SCALE)?PRECISION_FLOATEXP:PRECISION_DOUBLE;
+    }
+    else if(doubleDoubleKernel_)
+    {
+        //pixels are iterated from their offset to the view center, which is split into the two doubles here
+        precision_=PRECISION_DOUBLE_DOUBLE;
+        xCenterDD_=DoubleDouble(xCenter_,(r.xCenter-BigFixed(xCenter_)).toDouble());
+        yCenterDD_=DoubleDouble(yCenter_,(r.yCenter-BigFixed(yCenter_)).toDouble());
+        referenceX_=r.width/2;
+        referenceY_=r.height/2;
+        referenceOffsetX_=0.;
+        referenceOffsetY_=0.;
+    }
+    else
+        precision_=PRECISION_DOUBLE;
+    //offsets of deep zooms are taken relative to the scale, which keeps them within the range of double
+    offsetExponent_=deep_?r.scale.e:0;
+    offsetUnit_=std::ldexp(1.,offsetExponent_);
+    offsetScale_=std::ldexp(r.scale.m,r.scale.e-offsetExponent_);
+}
+
+void MandelbrotSet::sampleOffset(double fx, double fy, double &dx, double &dy) const
+{
+    const RenderRequest& r=request_;
+    if(r.exponential)
+    {
+        const double step=2*M_PI/r.width;
+        double radius=offsetScale_*std::exp(-fy*step);
+        dx=radius*std::cos(fx*step);
+        dy=radius*std::sin(fx*step);
+    }
+    else
+    {
+        dx=(fx-r.width/2)*offsetScale_;
+        dy=(fy-r.height/2)*offsetScale_;
+    }
+}
+
+FloatExp MandelbrotSet::pixelSpacing() const
+{
+    const RenderRequest& r=request_;
+    //the innermost row of an exponential map has the smallest pixels
+    if(r.exponential)
+    {
+        const double step=2*M_PI/r.width;
+        return r.scale*(std::exp(-(r.height-1)*step)*step);
+    }
+    return r.scale;
+}
+
+void MandelbrotSet::runTiles(qint32 progressOffset)
+{
+    nextTile_.store(0);
+    pixelsRendered_.store(0);
+    pixelsComputed_.store(0);
+    for(size_t i=0;i<contexts_.size();++i)
+        pool_.start(new TileWorker(this,contexts_[i]));
+    while(!pool_.waitForDone(REPORT_LINES_RENDERED_MS))
+        emit linesRendered(progressOffset+pixelsRendered_.load()/request_.width);
+}
+
+//sorts the tiles by their ring around the tile holding the render focus, and by angle within a ring, so the area
+//the user looks at is rendered first. the order doesn't affect the result.
+void MandelbrotSet::orderTiles()
+{
+    const RenderRequest& r=request_;
+    qint32 fx=(focusX_<0 || focusX_>=r.width)?r.width/2:focusX_;
+    qint32 fy=(focusY_<0 || focusY_>=r.height)?r.height/2:focusY_;
+    std::vector<std::pair<std::pair<qint32,double>,size_t> > keys;
+    for(size_t i=0;i<tiles_.size();++i)
+    {
+        const Tile& tile=tiles_[i];
+        qint32 dx=tile.x+tile.width/2-fx;
+        qint32 dy=tile.y+tile.height/2-fy;
+        qint32 ring=qMax(qAbs(dx),qAbs(dy))/TILE_SIZE;
+        keys.push_back(std::make_pair(std::make_pair(ring,std::atan2((double)dy,(double)dx)),i));
+    }
+    std::sort(keys.begin(),keys.end());
+    std::vector<Tile> tiles;
+    for(size_t i=0;i<keys.size();++i)
+        tiles.push_back(tiles_[keys[i].second]);
+    tiles_.swap(tiles);
+}
+
+void MandelbrotSet::deliverTile(const Tile &tile)
+{
+    QImage image(tile.width,tile.height,QImage::Format_RGB32);
+    for(qint32 y=0;y<tile.height;++y)
+    {
+        const quint32* src=imageBits_+(size_t)(tile.y+y)*imageStride_+tile.x;
+        std::copy(src,src+tile.width,reinterpret_cast<quint32*>(image.scanLine(y)));
+    }
+    emit tileOut(image,tile.x,tile.y,renderGeneration_);
+}
+
+//picks the middle one of all glitched pixels in scan order, which tends to lie inside a glitched area
+bool MandelbrotSet::findGlitchedPixel(qint32 &x, qint32 &y)
+{
+    std::vector<size_t> glitched;
+    for(size_t p=0;p<iterations_.status.size();++p)
+        if(iterations_.status[p]==IterationBuffer::GLITCHED)
+            glitched.push_back(p);
+    if(glitched.empty())
+        return false;
+    size_t p=glitched[glitched.size()/2];
+    x=(qint32)(p%request_.width);
+    y=(qint32)(p/request_.width);
+    return true;
+}
+
+void MandelbrotSet::computeReference(qint32 x, qint32 y)
+{
+    const RenderRequest& r=request_;
+    //enough fraction bits to resolve the pixel spacing with 64 bits to spare
+    qint32 precision=(qint32)std::ceil(-pixelSpacing().log2())+64;
+    double dx,dy;
+    pixelOffset(x,y,dx,dy);
+    BigFixed re=r.xCenter+BigFixed(FloatExp(dx,offsetExponent_));
+    BigFixed im=r.yCenter+BigFixed(FloatExp(dy,offsetExponent_));
+    std::function<bool()> cancelCheck=[this](){return cancelled();};
+    if(r.julia)
+        reference_.compute(re,im,BigFixed(r.cRe),BigFixed(r.cIm),polynomialPower_,nIt_,limit_,precision,cancelCheck);
+    else
+        reference_.compute(BigFixed(),BigFixed(),re,im,polynomialPower_,nIt_,limit_,precision,cancelCheck);
+    referenceX_=x;
+    referenceY_=y;
+    referenceOffsetX_=dx;
+    referenceOffsetY_=dy;
+}
+
+void MandelbrotSet::loadTile(const Tile &tile, const TileCache::Tile &cached)
+{
+    for(qint32 y=0;y<tile.height;++y)
+    {
+        size_t p=(size_t)(tile.y+y)*request_.width+tile.x;
+        size_t q=(size_t)y*tile.width;
+        std::copy(cached.zr.begin()+q,cached.zr.begin()+q+tile.width,iterations_.zr.begin()+p);
+        std::copy(cached.zi.begin()+q,cached.zi.begin()+q+tile.width,iterations_.zi.begin()+p);
+        std::copy(cached.it.begin()+q,cached.it.begin()+q+tile.width,iterations_.it.begin()+p);
+        std::copy(cached.status.begin()+q,cached.status.begin()+q+tile.width,iterations_.status.begin()+p);
+    }
+}
+
+void MandelbrotSet::storeTile(const Tile &tile, const TileCache::Key &key)
+{
+    TileCache::Tile cached;
+    for(qint32 y=0;y<tile.height;++y)
+    {
+        size_t p=(size_t)(tile.y+y)*request_.width+tile.x;
+        cached.zr.insert(cached.zr.end(),iterations_.zr.begin()+p,iterations_.zr.begin()+p+tile.width);
+        cached.zi.insert(cached.zi.end(),iterations_.zi.begin()+p,iterations_.zi.begin()+p+tile.width);
+        cached.it.insert(cached.it.end(),iterations_.it.begin()+p,iterations_.it.begin()+p+tile.width);
+        cached.status.insert(cached.status.end(),iterations_.status.begin()+p,iterations_.status.begin()+p+tile.width);
+    }
+    tileCache_.insert(key,cached);
+}
+
+void MandelbrotSet::renderTiles(FormulaContext &context)
+{
+    qint32 index;
+    if(antialiasing_)
+    {
+        qint32 chunks=((qint32)antialiasPixels_.size()+ANTIALIAS_CHUNK_SIZE-1)/ANTIALIAS_CHUNK_SIZE;
+        while(!cancelled() && (index=nextTile_.fetchAndAddOrdered(1))<chunks)
+            antialiasPixels(context,index*ANTIALIAS_CHUNK_SIZE,qMin((index+1)*ANTIALIAS_CHUNK_SIZE,(qint32)antialiasPixels_.size()));
+        return;
+    }
+    while(!cancelled() && (index=nextTile_.fetchAndAddOrdered(1))<(qint32)tiles_.size())
+    {
+        const Tile& tile=tiles_[index];
+        renderTile(context,tile);
+        pixelsRendered_.fetchAndAddRelaxed(tile.width*tile.height);
+        if(deliverTiles_ && !cancelled())
+            deliverTile(tile);
+    }
+}
+
+//the series is checked at the corners and edge centers of the view, which have the largest offsets to the center
+void MandelbrotSet::computeSeries()
+{
+    const RenderRequest& r=request_;
+    std::vector<std::complex<double> > probes;
+    double dx,dy;
+    if(r.exponential)
+    {
+        //the outermost row of an exponential map is a circle around the center, it's probed in 8 directions
+        for(qint32 i=0;i<8;++i)
+        {
+            referenceOffset(i*r.width/8,0,dx,dy);
+            probes.push_back(std::complex<double>(dx,dy));
+        }
+    }
+    else
+        for(qint32 i=0;i<3;++i)
+            for(qint32 j=0;j<3;++j)
+                if(i!=1 || j!=1)
                 {
-                    index[0]=(int)col0Interior_+(int)row0Interior_*paletteWidth+ixPal%(paletteWidth-(int)col0Interior_)+(iyPal%(paletteHeight-(int)row0Interior_))*paletteWidth;
-                    index[1]=(int)col0Interior_+(int)row0Interior_*paletteWidth+(ixPal+1)%(paletteWidth-(int)col0Interior_)+(iyPal%(paletteHeight-(int)row0Interior_))*paletteWidth;
-                    index[2]=(int)col0Interior_+(int)row0Interior_*paletteWidth+ixPal%(paletteWidth-(int)col0Interior_)+((iyPal+1)%(paletteHeight-(int)row0Interior_))*paletteWidth;
-                    index[3]=(int)col0Interior_+(int)row0Interior_*paletteWidth+(ixPal+1)%(paletteWidth-(int)col0Interior_)+((iyPal+1)%(paletteHeight-(int)row0Interior_))*paletteWidth;
+                    referenceOffset(i*(r.width-1)/2,j*(r.height-1)/2,dx,dy);
+                    probes.push_back(std::complex<double>(dx,dy));
                 }
-                for(qint32 i=0;i<4;++i)
-                    col[i]=QColor(palette[index[i]]);
-                scanline[ix]=colorInterp(col,xPal-ixPal,yPal-iyPal);
+    PerturbationKernel kernel=(precision_==PRECISION_FLOATEXP)?floatExpPerturbationKernel_:perturbationKernel_;
+    series_.compute(reference_,kernel,polynomialPower_,r.julia,probes,offsetExponent_,nIt_,limit_,[this](){return cancelled();});
+}
+
+void MandelbrotSet::renderTile(FormulaContext &context, const Tile &tile)
+{
+    if(recoloring_)
+    {
+        for(qint32 iy=tile.y;iy<tile.y+tile.height;++iy)
+        {
+            context.pixelX.clear();
+            context.pixelY.clear();
+            for(qint32 ix=tile.x;ix<tile.x+tile.width;++ix)
+            {
+                context.pixelX.push_back(ix);
+                context.pixelY.push_back(iy);
             }
-            if(iy%REPORT_LINES_RENDERED==0)
-                emit linesRendered(height*pass+iy+1);
+            colorPixels(context);
+        }
+        return;
+    }
+    context.periodicity=true;
+    if(subdivision_)
+    {
+        context.done.assign(tile.width*tile.height,0);
+        subdivide(context,tile,tile.x,tile.y,tile.width,tile.height);
+        return;
+    }
+    for(qint32 iy=tile.y;iy<tile.y+tile.height;++iy)
+    {
+        if(cancelled())
+            return;
+        context.pixelX.clear();
+        context.pixelY.clear();
+        for(qint32 ix=tile.x;ix<tile.x+tile.width;++ix)
+        {
+            context.pixelX.push_back(ix);
+            context.pixelY.push_back(iy);
         }
-        emit linesRendered(height*(pass+1));
-        emit imageOut(image);
+        renderPixels(context);
     }
 }
 
-void MandelbrotSet::renderJulia(double xCenter, double yCenter, qint32 width, qint32 height, double scale, qint32 nIterations, double limit, qint32 nPasses, double cRe, double cIm)
+//Mariani-Silver subdivision of a rectangle within a tile: its border is computed, the inside is filled with the border
+//color if all border pixels agree, otherwise the rectangle is split in four which share their edges.
+//context.done marks the pixels of the tile already computed or filled.
+void MandelbrotSet::subdivide(FormulaContext &context, const Tile &tile, qint32 x, qint32 y, qint32 w, qint32 h)
 {
-    if(--cancel_>0)
+    if(cancelled())
         return;
-    else
-        cancel_=0;
-    emit errorCodeOut(errorCode_);
-    if(errorCode_)
+    //rectangles too small to be worth splitting are computed entirely
+    const bool small=w<=MIN_SUBDIVISION_SIZE || h<=MIN_SUBDIVISION_SIZE;
+    context.pixelX.clear();
+    context.pixelY.clear();
+    for(qint32 iy=y;iy<y+h;++iy)
+    {
+        const bool edgeRow=small || iy==y || iy==y+h-1;
+        for(qint32 ix=x;ix<x+w;ix+=(edgeRow || ix==x+w-1)?1:w-1)
+        {
+            quint8& done=context.done[(iy-tile.y)*tile.width+ix-tile.x];
+            if(done)
+                continue;
+            done=1;
+            context.pixelX.push_back(ix);
+            context.pixelY.push_back(iy);
+        }
+    }
+    renderPixels(context);
+    if(small)
         return;
-    qint32 halfWidth=width/2;
-    qint32 halfHeight=height/2;
-    QImage image(width,height,QImage::Format_RGB32);
-    qint32 paletteWidth=colorPalette_.width();
-    qint32 paletteHeight=colorPalette_.height();
-    quint32 *palette=reinterpret_cast<quint32*>(colorPalette_.scanLine(0));
-    std::complex<double> *ec=eval_.getVarPtr('c'),*ez=eval_.getVarPtr('z');
-    //imaginary unit i
-    (*eval_.getVarPtr('i'))=std::complex<double>(0.0,1.0);
-    //s=Re(z), t=Im(z) when iteration loop is done
-    double *e1s=paletteXeval_.getVarPtr('s'), *e1t=paletteXeval_.getVarPtr('t');
-    double *e2s=paletteYeval_.getVarPtr('s'), *e2t=paletteYeval_.getVarPtr('t');
-    //u=x, v=y
-    double *e1u=paletteXeval_.getVarPtr('u'), *e1v=paletteXeval_.getVarPtr('v');
-    double *e2u=paletteYeval_.getVarPtr('u'), *e2v=paletteYeval_.getVarPtr('v');
-    //n=it (number of iterations before escape), m=nIterations (max. number of iterations), l=limit
-    double *e1n=paletteXeval_.getVarPtr('n'), *e1m=paletteXeval_.getVarPtr('m'), *e1l=paletteXeval_.getVarPtr('l');
-    double *e2n=paletteYeval_.getVarPtr('n'), *e2m=paletteYeval_.getVarPtr('m'), *e2l=paletteXeval_.getVarPtr('l');
-    //w=paletteWidth, h=paletteHeight
-    double *e1w=paletteXeval_.getVarPtr('w'), *e1h=paletteXeval_.getVarPtr('h');
-    double *e2w=paletteYeval_.getVarPtr('w'), *e2h=paletteYeval_.getVarPtr('h');
-
-    const qint32 upperLimit=(1<<(sizeof(int)*8-2));
-    *e1m=*e2m=(double)nIterations;
-    *e1l=*e2l=limit;
-    *e1w=*e2w=(double)paletteWidth;
-    *e1h=*e2h=(double)paletteHeight;
-    *ec=std::complex<double>(cRe,cIm);
-    col0Interior_&=(paletteWidth>1);
-    row0Interior_&=(paletteHeight>1);
-    for(qint32 pass=0;pass<nPasses;++pass)
-    {
-        qint32 nIt=nIterations>>(2*(nPasses-pass-1));
-        for(qint32 iy=0;iy<height;++iy)
-        {
-            quint32 *scanline=reinterpret_cast<quint32*>(image.scanLine(iy));
-            if(cancel_)
+    IterationBuffer& buffer=iterations_;
+    const size_t first=(size_t)y*request_.width+x;
+    const quint32 color=imageBits_[y*imageStride_+x];
+    bool uniform=true;
+    for(qint32 iy=y;iy<y+h && uniform;++iy)
+    {
+        const bool edgeRow=iy==y || iy==y+h-1;
+        for(qint32 ix=x;ix<x+w;ix+=(edgeRow || ix==x+w-1)?1:w-1)
+        {
+            size_t p=(size_t)iy*request_.width+ix;
+            if(imageBits_[iy*imageStride_+ix]!=color || buffer.it[p]!=buffer.it[first] ||
+                    buffer.escaped(p)!=buffer.escaped(first) ||
+                    buffer.status[p]==IterationBuffer::GLITCHED)
             {
-                --cancel_;
-                return;
+                uniform=false;
+                break;
             }
-            for(qint32 ix=0;ix<width;++ix)
+        }
+    }
+    if(uniform)
+    {
+        //filled pixels take the state of an escaped border, which colors them like the fill, and are marked as filled.
+        //inside a border that hasn't escaped they start over. either way their own orbit is unknown, so a later pass
+        //computing them iterates them from the beginning.
+        const bool escaped=buffer.escaped(first);
+        for(qint32 iy=y+1;iy<y+h-1;++iy)
+            for(qint32 ix=x+1;ix<x+w-1;++ix)
             {
-                double x=(ix-halfWidth)*scale+xCenter;
-                double y=(iy-halfHeight)*scale+yCenter;
+                context.done[(iy-tile.y)*tile.width+ix-tile.x]=1;
+                imageBits_[iy*imageStride_+ix]=color;
+                size_t p=(size_t)iy*request_.width+ix;
+                buffer.zr[p]=buffer.zr[first];
+                buffer.zi[p]=buffer.zi[first];
+                buffer.it[p]=escaped?buffer.it[first]:-1;
+                buffer.status[p]=escaped?IterationBuffer::FILLED:IterationBuffer::ITERATING;
+            }
+        return;
+    }
+    qint32 mx=x+w/2;
+    qint32 my=y+h/2;
+    subdivide(context,tile,x,y,mx-x+1,my-y+1);
+    subdivide(context,tile,mx,y,x+w-mx,my-y+1);
+    subdivide(context,tile,x,my,mx-x+1,y+h-my);
+    subdivide(context,tile,mx,my,x+w-mx,y+h-my);
+}
 
-                *ez=std::complex<double>(x,y);
-                qint32 it=0;
-                while(it<nIt && (ez->real()*ez->real()+ez->imag()*ez->imag())<=limit)
-                {
-                    eval_.run();
-                    *ez=eval_.result();
-                    ++it;
-                }
-                *e1s=*e2s=ez->real();
-                *e1t=*e2t=ez->imag();
-                *e1u=*e2u=x;
-                *e1v=*e2v=y;
-                *e1n=*e2n=(double)it;
-                double xPal,yPal;
-                qint32 ixPal,iyPal;
-                paletteXeval_.run();
-                paletteYeval_.run();
-                xPal=paletteXeval_.result();
-                yPal=paletteYeval_.result();
-                xPal=(xPal<0 || xPal>upperLimit || xPal!=xPal)?0:xPal;
-                yPal=(yPal<0 || yPal>upperLimit || yPal!=yPal)?0:yPal;
-                ixPal=(int)xPal;
-                iyPal=(int)yPal;
-                qint32 index[4];
-                QColor col[4];
-                if(it==nIt)
-                {
-                    if(col0Interior_)
-                    {
-                        xPal=0;
-                        ixPal=0;
-                    }
-                    if(row0Interior_)
-                    {
-                        yPal=0;
-                        iyPal=0;
-                    }
-                    index[0]=ixPal%paletteWidth+(iyPal%paletteHeight)*paletteWidth;
-                    index[1]=(ixPal+1)%paletteWidth+(iyPal%paletteHeight)*paletteWidth;
-                    index[2]=ixPal%paletteWidth+((iyPal+1)%paletteHeight)*paletteWidth;
-                    index[3]=(ixPal+1)%paletteWidth+((iyPal+1)%paletteHeight)*paletteWidth;
-                }
-                else
+//iterates the pixels listed in context.pixelX, context.pixelY as far as the current pass requires and colors them
+void MandelbrotSet::renderPixels(FormulaContext &context)
+{
+    const RenderRequest& r=request_;
+    const qint32 nIt=nIt_;
+    const double limit=limit_;
+    IterationBuffer& buffer=iterations_;
+    //perturbed and double-double pixels start over from their offset to a reference pixel on every pass
+    const bool relative=deep_ || precision_==PRECISION_DOUBLE_DOUBLE;
+    const bool cardioidCheck=!r.julia && !relative && polynomialPower_==2;
+    qint32 n=(qint32)context.pixelX.size();
+    if((qint32)context.it.size()<n)
+    {
+        context.zr.resize(n);
+        context.zi.resize(n);
+        context.cr.resize(n);
+        context.ci.resize(n);
+        context.it.resize(n);
+        context.index.resize(n);
+        context.glitched.resize(n);
+    }
+    pixelsComputed_.fetchAndAddRelaxed(n);
+    //gather the pixels which haven't escaped and haven't reached nIt yet, as well as glitched ones
+    qint32 count=0;
+    for(qint32 k=0;k<n;++k)
+    {
+        qint32 ix=context.pixelX[k],iy=context.pixelY[k];
+        size_t p=(size_t)iy*r.width+ix;
+        double x,y;
+        pixelOffset(ix,iy,x,y);
+        x=xCenter_+x*offsetUnit_;
+        y=yCenter_+y*offsetUnit_;
+        if(buffer.it[p]<0 || buffer.status[p]==IterationBuffer::FILLED)
+        {
+            buffer.zr[p]=r.julia?x:0.;
+            buffer.zi[p]=r.julia?y:0.;
+            buffer.it[p]=0;
+            buffer.status[p]=IterationBuffer::ITERATING;
+            if(cardioidCheck && insideCardioidOrBulb(x,y))
+                buffer.status[p]=IterationBuffer::INTERIOR;
+        }
+        if(buffer.status[p]==IterationBuffer::INTERIOR)
+            buffer.it[p]=nIt;
+        if(buffer.status[p]==IterationBuffer::ESCAPED || buffer.status[p]==IterationBuffer::INTERIOR ||
+                (buffer.status[p]==IterationBuffer::ITERATING && buffer.it[p]>=nIt))
+            continue;
+        context.index[count]=k;
+        if(relative)
+        {
+            double dx,dy;
+            referenceOffset(ix,iy,dx,dy);
+            context.zr[count]=r.julia?dx:0.;
+            context.zi[count]=r.julia?dy:0.;
+            context.cr[count]=r.julia?0.:dx;
+            context.ci[count]=r.julia?0.:dy;
+            context.it[count]=0;
+        }
+        else
+        {
+            context.zr[count]=buffer.zr[p];
+            context.zi[count]=buffer.zi[p];
+            context.cr[count]=r.julia?r.cRe:x;
+            context.ci[count]=r.julia?r.cIm:y;
+            context.it[count]=buffer.it[p];
+        }
+        ++count;
+    }
+    //iterations replaced by the series approximation don't count
+    context.iterations-=(qint64)(deep_?series_.skip:0)*count;
+    for(qint32 j=0;j<count;++j)
+        context.iterations-=context.it[j];
+    QElapsedTimer timer;
+    timer.start();
+    //pixels left out by a cancellation keep their state
+    qint32 iterated=iterateSlices(context,count);
+    context.iterationNsecs+=timer.nsecsElapsed();
+    for(qint32 j=0;j<count;++j)
+        context.iterations+=context.it[j];
+    if(count)
+        context.periodicity=false;
+    for(qint32 j=0;j<iterated;++j)
+    {
+        qint32 k=context.index[j];
+        size_t p=(size_t)context.pixelY[k]*r.width+context.pixelX[k];
+        double zr=context.zr[j],zi=context.zi[j];
+        buffer.zr[p]=zr;
+        buffer.zi[p]=zi;
+        buffer.it[p]=context.it[j];
+        if(deep_ && context.glitched[j])
+            buffer.status[p]=IterationBuffer::GLITCHED;
+        else if(zr*zr+zi*zi>limit)
+            buffer.status[p]=IterationBuffer::ESCAPED;
+        else
+        {
+            buffer.status[p]=IterationBuffer::ITERATING;
+            context.periodicity=true;
+        }
+    }
+    if(iterated<count)
+        return;
+    colorPixels(context);
+}
+
+//colors of all iteration counts of escaped and interior pixels, if the palette formulas allow it and the table
+//takes fewer evaluations than the pixels of the image
+void MandelbrotSet::preparePaletteTable()
+{
+    const qint32 nIterations=request_.nIterations;
+    paletteTable_.clear();
+    if(!paletteXIterationsOnly_ || !paletteYIterationsOnly_ || 2*((qint64)nIterations+1)>(qint64)request_.width*request_.height)
+        return;
+    paletteTable_.resize(2*((size_t)nIterations+1));
+    for(qint32 n=0;n<=nIterations;++n)
+    {
+        //a cancelled render colors nothing
+        if(!(n%CANCEL_CHECK_ROUNDS) && cancelled())
+        {
+            paletteTable_.clear();
+            return;
+        }
+        paletteTable_[n]=paletteColor(*contexts_[0],0.,0.,0.,0.,n,false);
+        paletteTable_[nIterations+1+n]=paletteColor(*contexts_[0],0.,0.,0.,0.,n,true);
+    }
+}
+
+//colors the pixels listed in context.pixelX, context.pixelY according to their state in the iteration buffer
+void MandelbrotSet::colorPixels(FormulaContext &context)
+{
+    const RenderRequest& r=request_;
+    const IterationBuffer& buffer=iterations_;
+    qint32 n=(qint32)context.pixelX.size();
+    if((qint32)context.colors.size()<n)
+    {
+        context.xPal.resize(n);
+        context.yPal.resize(n);
+        context.interior.resize(n);
+        context.colors.resize(n);
+    }
+    if((qint32)context.index.size()<n)
+        context.index.resize(n);
+    QElapsedTimer timer;
+    timer.start();
+    qint32 count=0;
+    for(qint32 k=0;k<n;++k)
+    {
+        qint32 ix=context.pixelX[k],iy=context.pixelY[k];
+        size_t p=(size_t)iy*r.width+ix;
+        qint32 it=buffer.it[p];
+        bool interior=!buffer.escaped(p);
+        if(!paletteTable_.empty() && it>=0 && it<=r.nIterations)
+        {
+            imageBits_[iy*imageStride_+ix]=paletteTable_[interior?r.nIterations+1+it:it];
+            continue;
+        }
+        double x,y;
+        pixelOffset(ix,iy,x,y);
+        x=xCenter_+x*offsetUnit_;
+        y=yCenter_+y*offsetUnit_;
+        paletteCoordinates(context,buffer.zr[p],buffer.zi[p],x,y,it,context.xPal[count],context.yPal[count]);
+        context.interior[count]=interior;
+        context.index[count]=k;
+        ++count;
+    }
+    paletteSampler_.sample(context.xPal.data(),context.yPal.data(),context.interior.data(),context.colors.data(),count);
+    for(qint32 j=0;j<count;++j)
+    {
+        qint32 k=context.index[j];
+        imageBits_[context.pixelY[k]*imageStride_+context.pixelX[k]]=context.colors[j];
+    }
+    context.paletteNsecs+=timer.nsecsElapsed();
+}
+
+//picks the pixels whose color differs from a neighbor's by more than the threshold, or which lie on the border of the set.
+//if they'd take more samples than the budget allows, the ones with the largest differences are kept.
+//returns false if cancelled.
+bool MandelbrotSet::antialias()
+{
+    const RenderRequest& r=request_;
+    if(antialiasSamples_<=1)
+        return true;
+    const qint32 width=r.width,height=r.height;
+    std::vector<quint8> contrast((size_t)width*height,0);
+    for(qint32 y=0;y<height;++y)
+        for(qint32 x=0;x<width;++x)
+        {
+            size_t p=(size_t)y*width+x;
+            QRgb c=imageBits_[y*imageStride_+x];
+            bool interior=!iterations_.escaped(p);
+            for(qint32 k=0;k<2;++k)
+            {
+                qint32 nx=x+(k==0),ny=y+(k==1);
+                if(nx>=width || ny>=height)
+                    continue;
+                size_t q=(size_t)ny*width+nx;
+                QRgb d=imageBits_[ny*imageStride_+nx];
+                quint8 difference=(quint8)qMax(qAbs(qRed(c)-qRed(d)),qMax(qAbs(qGreen(c)-qGreen(d)),qAbs(qBlue(c)-qBlue(d))));
+                if(interior==iterations_.escaped(q))
+                    difference=255;
+                contrast[p]=qMax(contrast[p],difference);
+                contrast[q]=qMax(contrast[q],difference);
+            }
+        }
+    antialiasPixels_.clear();
+    for(size_t p=0;p<contrast.size();++p)
+        if(contrast[p]>antialiasThreshold_)
+            antialiasPixels_.push_back((qint32)p);
+    size_t maxPixels=(size_t)(antialiasBudget_*width*height/(antialiasSamples_-1));
+    if(antialiasPixels_.size()>maxPixels)
+    {
+        std::nth_element(antialiasPixels_.begin(),antialiasPixels_.begin()+maxPixels,antialiasPixels_.end(),
+                         [&contrast](qint32 a,qint32 b){return contrast[a]>contrast[b];});
+        antialiasPixels_.resize(maxPixels);
+        std::sort(antialiasPixels_.begin(),antialiasPixels_.end());
+    }
+    antialiasing_=true;
+    runTiles(r.height*r.nPasses);
+    antialiasing_=false;
+    return !cancelled();
+}
+
+//the extra samples of a pixel lie in the cells of a grid over the pixel, the cells are spread evenly over the samples
+//and jittered by a hash of pixel and sample, so images don't change between renders
+void MandelbrotSet::antialiasPixels(FormulaContext &context, qint32 begin, qint32 end)
+{
+    const RenderRequest& r=request_;
+    const qint32 extra=antialiasSamples_-1;
+    const qint32 grid=(qint32)std::ceil(std::sqrt((double)antialiasSamples_));
+    const bool relative=deep_ || precision_==PRECISION_DOUBLE_DOUBLE;
+    const bool cardioidCheck=!r.julia && !relative && polynomialPower_==2;
+    qint32 n=(end-begin)*extra;
+    if((qint32)context.it.size()<n)
+    {
+        context.zr.resize(n);
+        context.zi.resize(n);
+        context.cr.resize(n);
+        context.ci.resize(n);
+        context.it.resize(n);
+        context.index.resize(n);
+        context.glitched.resize(n);
+    }
+    if((qint32)context.colors.size()<n)
+    {
+        context.xPal.resize(n);
+        context.yPal.resize(n);
+        context.interior.resize(n);
+        context.colors.resize(n);
+    }
+    std::vector<double> sampleX(n),sampleY(n);
+    std::vector<quint8> skipped(n,0);
+    //samples known to be interior are set up as such and not iterated, the others are gathered at the front
+    qint32 count=0;
+    for(qint32 k=0;k<n;++k)
+    {
+        qint32 p=antialiasPixels_[begin+k/extra],s=k%extra;
+        qint32 ix=p%r.width,iy=p/r.width;
+        qint32 cell=(qint32)(((qint64)s*grid*grid)/extra);
+        quint32 hash=(quint32)p*2654435761u^(quint32)(s+1)*2246822519u;
+        hash^=hash>>15;
+        hash*=2246822519u;
+        hash^=hash>>13;
+        double fx=ix-0.5+(cell%grid+(hash&0xffff)/65536.)/grid;
+        double fy=iy-0.5+(cell/grid+(hash>>16)/65536.)/grid;
+        double dx,dy;
+        sampleOffset(fx,fy,dx,dy);
+        double x=xCenter_+dx*offsetUnit_,y=yCenter_+dy*offsetUnit_;
+        sampleX[k]=x;
+        sampleY[k]=y;
+        if(cardioidCheck && insideCardioidOrBulb(x,y))
+        {
+            skipped[k]=1;
+            continue;
+        }
+        if(relative)
+        {
+            if(r.exponential)
+            {
+                dx-=referenceOffsetX_;
+                dy-=referenceOffsetY_;
+            }
+            else
+            {
+                dx=(fx-referenceX_)*offsetScale_;
+                dy=(fy-referenceY_)*offsetScale_;
+            }
+            context.zr[count]=r.julia?dx:0.;
+            context.zi[count]=r.julia?dy:0.;
+            context.cr[count]=r.julia?0.:dx;
+            context.ci[count]=r.julia?0.:dy;
+        }
+        else
+        {
+            context.zr[count]=r.julia?x:0.;
+            context.zi[count]=r.julia?y:0.;
+            context.cr[count]=r.julia?r.cRe:x;
+            context.ci[count]=r.julia?r.cIm:y;
+        }
+        context.it[count]=0;
+        context.index[count]=k;
+        ++count;
+    }
+    //the vectorized kernels outrun cycle detection, interior samples mostly lie in the cardioid or bulb anyway
+    context.periodicity=false;
+    QElapsedTimer timer;
+    timer.start();
+    if(iterateSlices(context,count)<count)
+        return;
+    context.iterationNsecs+=timer.nsecsElapsed();
+    timer.start();
+    context.iterations-=(qint64)(deep_?series_.skip:0)*count;
+    for(qint32 j=0;j<count;++j)
+        context.iterations+=context.it[j];
+    //states of all samples in sample order, skipped ones start at z=0 like interior pixels of the iteration buffer
+    std::vector<double> zr(n,0.),zi(n,0.);
+    std::vector<qint32> it(n,nIt_);
+    for(qint32 j=0;j<count;++j)
+    {
+        qint32 k=context.index[j];
+        if(deep_ && context.glitched[j])
+            skipped[k]=2;
+        zr[k]=context.zr[j];
+        zi[k]=context.zi[j];
+        it[k]=context.it[j];
+    }
+    qint32 colored=0;
+    std::vector<quint32> colors(n,0);
+    std::vector<quint8> valid(n,1);
+    for(qint32 k=0;k<n;++k)
+    {
+        //glitched samples are left out
+        if(skipped[k]==2)
+        {
+            valid[k]=0;
+            continue;
+        }
+        bool interior=skipped[k] || zr[k]*zr[k]+zi[k]*zi[k]<=limit_;
+        if(!paletteTable_.empty() && it[k]>=0 && it[k]<=r.nIterations)
+        {
+            colors[k]=paletteTable_[interior?r.nIterations+1+it[k]:it[k]];
+            continue;
+        }
+        paletteCoordinates(context,zr[k],zi[k],sampleX[k],sampleY[k],it[k],context.xPal[colored],context.yPal[colored]);
+        context.interior[colored]=interior;
+        context.index[colored]=k;
+        ++colored;
+    }
+    paletteSampler_.sample(context.xPal.data(),context.yPal.data(),context.interior.data(),context.colors.data(),colored);
+    for(qint32 j=0;j<colored;++j)
+        colors[context.index[j]]=context.colors[j];
+    //the pixel's own sample counts like every other
+    for(qint32 i=begin;i<end;++i)
+    {
+        qint32 p=antialiasPixels_[i];
+        quint32& pixel=imageBits_[(p/r.width)*imageStride_+p%r.width];
+        qint32 red=qRed(pixel),green=qGreen(pixel),blue=qBlue(pixel),samples=1;
+        for(qint32 k=(i-begin)*extra;k<(i-begin+1)*extra;++k)
+            if(valid[k])
+            {
+                red+=qRed(colors[k]);
+                green+=qGreen(colors[k]);
+                blue+=qBlue(colors[k]);
+                ++samples;
+            }
+        pixel=qRgb((red+samples/2)/samples,(green+samples/2)/samples,(blue+samples/2)/samples);
+    }
+    context.paletteNsecs+=timer.nsecsElapsed();
+}
+
+//continues iterating the gathered pixels from the number of iterations already done
+qint32 MandelbrotSet::iterateSlices(FormulaContext &context, qint32 count)
+{
+    const qint32 slice=qMax(1,CANCEL_CHECK_ITERATIONS/qMax(nIt_,1));
+    qint32 first=0;
+    for(;first<count && !cancelled();first+=slice)
+        iterateRow(context,first,qMin(slice,count-first));
+    return qMin(first,count);
+}
+
+void MandelbrotSet::iterateRow(FormulaContext &context, qint32 first, qint32 count)
+{
+    const qint32 nIt=nIt_;
+    const double limit=limit_;
+    double *zr=context.zr.data()+first,*zi=context.zi.data()+first;
+    const double *cr=context.cr.data()+first,*ci=context.ci.data()+first;
+    qint32 *it=context.it.data()+first;
+    if(!count)
+        return;
+    if(deep_)
+    {
+        PerturbationKernel kernel=(precision_==PRECISION_FLOATEXP)?floatExpPerturbationKernel_:perturbationKernel_;
+        const qint32 skip=series_.skip;
+        const bool julia=request_.julia;
+        for(qint32 k=0;k<count;++k)
+        {
+            bool glitched;
+            //the offset is dz_0 for Julia sets and dc otherwise
+            if(skip)
+                series_.evaluate(julia?zr[k]:cr[k],julia?zi[k]:ci[k],zr[k],zi[k]);
+            it[k]=kernel(reference_,zr[k],zi[k],cr[k],ci[k],offsetExponent_,skip,nIt,limit,glitched);
+            context.glitched[first+k]=glitched;
+        }
+        return;
+    }
+    if(precision_==PRECISION_DOUBLE_DOUBLE)
+    {
+        const bool julia=request_.julia;
+        const DoubleDouble juliaRe(request_.cRe),juliaIm(request_.cIm);
+        for(qint32 k=0;k<count;++k)
+        {
+            DoubleDouble zRe=julia?xCenterDD_+zr[k]:DoubleDouble(zr[k]);
+            DoubleDouble zIm=julia?yCenterDD_+zi[k]:DoubleDouble(zi[k]);
+            it[k]=doubleDoubleKernel_(zRe,zIm,julia?juliaRe:xCenterDD_+cr[k],julia?juliaIm:yCenterDD_+ci[k],nIt,limit);
+            zr[k]=zRe.hi;
+            zi[k]=zIm.hi;
+        }
+        return;
+    }
+    //rows with cycle detection run on the scalar kernels, the vectorized ones have no periodicity check
+    const bool single=(precision_==PRECISION_FLOAT);
+    const bool periodicity=context.periodicity;
+    BatchEscapeKernel batchKernel=periodicity?0:(single?floatBatchKernel_:batchKernel_);
+    EscapeKernel kernel=single?(periodicity?periodicFloatKernel_:floatKernel_):(periodicity?periodicKernel_:kernel_);
+    if(batchKernel)
+    {
+        //the vectorized kernel needs all lanes to start from the same iteration, which is the case unless a pass was cancelled
+        bool uniform=true;
+        for(qint32 k=1;k<count && uniform;++k)
+            uniform=(it[k]==it[0]);
+        if(uniform)
+        {
+            qint32 start=it[0];
+            batchKernel(zr,zi,cr,ci,it,count,nIt-start,limit);
+            for(qint32 k=0;k<count;++k)
+                it[k]+=start;
+            return;
+        }
+    }
+    if(kernel)
+    {
+        for(qint32 k=0;k<count;++k)
+            it[k]+=kernel(zr[k],zi[k],cr[k],ci[k],nIt-it[k],limit);
+        return;
+    }
+    if(batchProgram_.isValid())
+    {
+        iterateRowBatched(context,first,count);
+        return;
+    }
+    const double tolerance=periodicityTolerance<double>();
+    std::complex<double> *ec=context.c,*ez=context.z;
+    for(qint32 k=0;k<count;++k)
+    {
+        *ec=std::complex<double>(cr[k],ci[k]);
+        *ez=std::complex<double>(zr[k],zi[k]);
+        qint32 n=it[k];
+        //Brent's cycle detection, see periodicPolynomialKernel
+        std::complex<double> saved=*ez;
+        qint32 period=0,checkPeriod=1;
+        while(n<nIt && (ez->real()*ez->real()+ez->imag()*ez->imag())<=limit)
+        {
+            //see iterateRowBatched
+            if(!((n+1)%CANCEL_CHECK_ROUNDS) && cancelled())
+                break;
+            context.eval.run();
+            *ez=context.eval.result();
+            ++n;
+            if(!periodicity)
+                continue;
+            if(qAbs(ez->real()-saved.real())<tolerance && qAbs(ez->imag()-saved.imag())<tolerance)
+                n=nIt;
+            else if(++period==checkPeriod)
+            {
+                period=0;
+                checkPeriod*=2;
+                saved=*ez;
+            }
+        }
+        zr[k]=ez->real();
+        zi[k]=ez->imag();
+        it[k]=n;
+    }
+}
+
+void MandelbrotSet::iterateRowBatched(FormulaContext &context, qint32 first, qint32 count)
+{
+    const qint32 LANES=BatchEval<double>::LANES;
+    const qint32 nIt=nIt_;
+    const double limit=limit_;
+    double *zr=context.zr.data()+first,*zi=context.zi.data()+first;
+    const double *cr=context.cr.data()+first,*ci=context.ci.data()+first;
+    qint32 *it=context.it.data()+first;
+    //each lane iterates one pixel of the row. lanes whose pixel escaped or reached the iteration limit are
+    //retired and refilled with the next pending pixel, so the formula always runs on densely packed lanes
+    double laneZr[LANES],laneZi[LANES],laneCr[LANES],laneCi[LANES];
+    qint32 laneIt[LANES],lanePixel[LANES];
+    //cycle detection state per lane, see periodicPolynomialKernel
+    const bool periodicity=context.periodicity;
+    const double tolerance=periodicityTolerance<double>();
+    double laneSavedR[LANES],laneSavedI[LANES];
+    qint32 lanePeriod[LANES],laneCheckPeriod[LANES];
+    qint32 nLanes=0,next=0,rounds=0;
+    for(;;)
+    {
+        qint32 k=0;
+        while(k<nLanes)
+        {
+            if(laneIt[k]<nIt && laneZr[k]*laneZr[k]+laneZi[k]*laneZi[k]<=limit)
+            {
+                ++k;
+                continue;
+            }
+            qint32 p=lanePixel[k];
+            zr[p]=laneZr[k];
+            zi[p]=laneZi[k];
+            it[p]=laneIt[k];
+            --nLanes;
+            laneZr[k]=laneZr[nLanes];
+            laneZi[k]=laneZi[nLanes];
+            laneCr[k]=laneCr[nLanes];
+            laneCi[k]=laneCi[nLanes];
+            laneIt[k]=laneIt[nLanes];
+            lanePixel[k]=lanePixel[nLanes];
+            laneSavedR[k]=laneSavedR[nLanes];
+            laneSavedI[k]=laneSavedI[nLanes];
+            lanePeriod[k]=lanePeriod[nLanes];
+            laneCheckPeriod[k]=laneCheckPeriod[nLanes];
+        }
+        for(;nLanes<LANES && next<count;++next)
+        {
+            if(it[next]>=nIt || zr[next]*zr[next]+zi[next]*zi[next]>limit)
+                continue;
+            laneZr[nLanes]=zr[next];
+            laneZi[nLanes]=zi[next];
+            laneCr[nLanes]=cr[next];
+            laneCi[nLanes]=ci[next];
+            laneIt[nLanes]=it[next];
+            lanePixel[nLanes]=next;
+            laneSavedR[nLanes]=zr[next];
+            laneSavedI[nLanes]=zi[next];
+            lanePeriod[nLanes]=0;
+            laneCheckPeriod[nLanes]=1;
+            ++nLanes;
+        }
+        if(!nLanes)
+            break;
+        //interpreted formulas are slow enough to check for cancellation within a pixel, its state is kept to continue from
+        if(!(++rounds%CANCEL_CHECK_ROUNDS) && cancelled())
+        {
+            for(k=0;k<nLanes;++k)
+            {
+                zr[lanePixel[k]]=laneZr[k];
+                zi[lanePixel[k]]=laneZi[k];
+                it[lanePixel[k]]=laneIt[k];
+            }
+            return;
+        }
+        context.batchEval.run(laneZr,laneZi,laneCr,laneCi,nLanes);
+        const double *resultRe=context.batchEval.resultRe(),*resultIm=context.batchEval.resultIm();
+        for(k=0;k<nLanes;++k)
+        {
+            laneZr[k]=resultRe[k];
+            laneZi[k]=resultIm[k];
+            ++laneIt[k];
+        }
+        if(periodicity)
+        {
+            for(k=0;k<nLanes;++k)
+            {
+                if(qAbs(laneZr[k]-laneSavedR[k])<tolerance && qAbs(laneZi[k]-laneSavedI[k])<tolerance)
+                    laneIt[k]=nIt;
+                else if(++lanePeriod[k]==laneCheckPeriod[k])
                 {
-                    index[0]=(int)col0Interior_+(int)row0Interior_*paletteWidth+ixPal%(paletteWidth-(int)col0Interior_)+(iyPal%(paletteHeight-(int)row0Interior_))*paletteWidth;
-                    index[1]=(int)col0Interior_+(int)row0Interior_*paletteWidth+(ixPal+1)%(paletteWidth-(int)col0Interior_)+(iyPal%(paletteHeight-(int)row0Interior_))*paletteWidth;
-                    index[2]=(int)col0Interior_+(int)row0Interior_*paletteWidth+ixPal%(paletteWidth-(int)col0Interior_)+((iyPal+1)%(paletteHeight-(int)row0Interior_))*paletteWidth;
-                    index[3]=(int)col0Interior_+(int)row0Interior_*paletteWidth+(ixPal+1)%(paletteWidth-(int)col0Interior_)+((iyPal+1)%(paletteHeight-(int)row0Interior_))*paletteWidth;
+                    lanePeriod[k]=0;
+                    laneCheckPeriod[k]*=2;
+                    laneSavedR[k]=laneZr[k];
+                    laneSavedI[k]=laneZi[k];
                 }
-                for(qint32 i=0;i<4;++i)
-                    col[i]=QColor(palette[index[i]]);
-                scanline[ix]=colorInterp(col,xPal-ixPal,yPal-iyPal);
             }
-            if(iy%REPORT_LINES_RENDERED==0)
-                emit linesRendered(height*pass+iy+1);
         }
-        emit linesRendered(height*(pass+1));
-        emit imageOut(image);
     }
 }
+
+void MandelbrotSet::paletteCoordinates(FormulaContext &context, double zr, double zi, double u, double v, qint32 it, double &xPal, double &yPal)
+{
+    PaletteVars &px=context.paletteX,&py=context.paletteY;
+    *px.s=*py.s=zr;
+    *px.t=*py.t=zi;
+    *px.u=*py.u=u;
+    *px.v=*py.v=v;
+    *px.n=*py.n=(double)it;
+    context.paletteXeval.run();
+    context.paletteYeval.run();
+    xPal=context.paletteXeval.result();
+    yPal=context.paletteYeval.result();
+}
+
+QRgb MandelbrotSet::paletteColor(FormulaContext &context, double zr, double zi, double u, double v, qint32 it, bool interior)
+{
+    double xPal,yPal;
+    quint8 interiorFlag=interior;
+    quint32 color;
+    paletteCoordinates(context,zr,zi,u,v,it,xPal,yPal);
+    paletteSampler_.sample(&xPal,&yPal,&interiorFlag,&color,1);
+    return color;
+}
@@ -5,17 +5,29 @@
 #include <QObject>
 #include <QColor>
 #include <QString>
+#include <QThreadPool>
+#include <QAtomicInt>
 #include <complex>
+#include <vector>
 #include "MathParser/mathparser.h"
+#include "formulakernels.h"
+#include "simdkernels.h"
+#include "batcheval.h"
+#include "iterationbuffer.h"
+#include "tilecache.h"
+#include "palettesampler.h"
+#include "bigfixed.h"
+#include "perturbation.h"
+#include "precision.h"
 
 
 struct MandelbrotConfig
 {
     QString formula;
     double limit;
-    double centerX;
-    double centerY;
-    double scale;
+    BigFixed centerX;
+    BigFixed centerY;
+    FloatExp scale;
     qint32 nIterations;
     QString colorPaletteFileName;
     QString paletteFormulaX;
@@ -25,6 +37,106 @@ struct MandelbrotConfig
     bool julia;
     double juliaRe;
     double juliaIm;
+    //true if other differs at most in the coloring settings, so its image only needs to be recolored
+    bool sameView(const MandelbrotConfig& other) const
+    {
+        return formula==other.formula && limit==other.limit && centerX==other.centerX && centerY==other.centerY &&
+                scale==other.scale && nIterations==other.nIterations && julia==other.julia &&
+                juliaRe==other.juliaRe && juliaIm==other.juliaIm;
+    }
+};
+
+//parameters of a single render request as passed to the render slots
+struct RenderRequest
+{
+    BigFixed xCenter;
+    BigFixed yCenter;
+    qint32 width;
+    qint32 height;
+    FloatExp scale;
+    qint32 nIterations;
+    double limit;
+    qint32 nPasses;
+    bool julia;
+    double cRe;
+    double cIm;
+    //exponential map around the center: columns are angles 2pi/width apart, rows are radii starting at scale and
+    //shrinking by exp(2pi/width) per row, so pixels stay square and every row zooms in a little further
+    bool exponential;
+    //generation returned by the MandelbrotSet::cancel() issued for this request, requests of older generations are dropped
+    qint32 generation;
+};
+
+Q_DECLARE_METATYPE(RenderRequest)
+
+//what a render pass did, see MandelbrotSet::statsOut
+struct RenderStats
+{
+    qint32 pass;
+    qint32 nPasses;
+    qint32 threads;
+    //iteration limit of the pass
+    qint32 nIterations;
+    //iterations run, pixels caught in a cycle count as run to the limit
+    qint64 iterations;
+    qint64 escapedPixels;
+    qint64 interiorPixels;
+    //escaped pixels by iteration count, bin i starts at i*(nIterations+1)/histogram.size()
+    std::vector<qint64> histogram;
+    double seconds;
+    //time the workers spent in the iteration loop and the palette stage, summed over threads
+    double iterationSeconds;
+    double paletteSeconds;
+};
+
+Q_DECLARE_METATYPE(RenderStats)
+
+//pointers to the variables of a palette formula
+struct PaletteVars
+{
+    double *s,*t,*u,*v,*n,*m,*l,*w,*h;
+    void bind(MathEval<double>& eval);
+};
+
+//formulas as parsed by a single render worker. MathEval hands out its variables as slots via getVarPtr,
+//so evaluators can't be shared between threads and every worker parses its own copy of the formulas.
+struct FormulaContext
+{
+    MathParser<std::complex<double> > parser;
+    MathParser<double> paletteXparser;
+    MathParser<double> paletteYparser;
+    MathEval<std::complex<double> > eval;
+    MathEval<double> paletteXeval;
+    MathEval<double> paletteYeval;
+    std::complex<double> *c,*z;
+    BatchEval<double> batchEval;
+    PaletteVars paletteX;
+    PaletteVars paletteY;
+    //image coordinates of the pixels of a tile row, or of a rectangle border in subdivision mode, to be rendered
+    std::vector<qint32> pixelX,pixelY;
+    //scratch buffers holding those of the pixels which still need iterating: z, c and the number of iterations
+    //done so far, updated in place by the iteration stage. index is the position of the pixel within pixelX, pixelY.
+    std::vector<double> zr,zi,cr,ci;
+    std::vector<qint32> it,index;
+    std::vector<quint8> glitched;
+    //palette coordinates of the pixels to be colored and their colors, index is their position within pixelX, pixelY
+    std::vector<double> xPal,yPal;
+    std::vector<quint8> interior;
+    std::vector<quint32> colors;
+    //pixels of the current tile already computed or filled in subdivision mode
+    std::vector<quint8> done;
+    //check for cycles while iterating the current pixels, set if the previous ones of the tile had unescaped pixels
+    bool periodicity;
+    //revision of the formula strings this context was parsed from
+    qint32 revision;
+    //iterations run and nanoseconds spent iterating and coloring by this context during the current pass
+    qint64 iterations;
+    qint64 iterationNsecs,paletteNsecs;
+    FormulaContext(): revision(-1), iterations(0), iterationNsecs(0), paletteNsecs(0) {
+        parser.setMathEval(&eval);
+        paletteXparser.setMathEval(&paletteXeval);
+        paletteYparser.setMathEval(&paletteYeval);
+    }
 };
 
 //MandelbrotSet class renders an area of the set of complex numbers z whose norm squared stays below a given limit
@@ -34,6 +146,10 @@ struct MandelbrotConfig
 //n: number of iterations before reaching the limit, m: maximum number of iterations
 //s,t: real and imaginary components of z, u,v: real and imaginary components corresponding to the current pixel,
 //h,w: height and width of the color palette in pixels
+//The image is split into tiles which are rendered in parallel by a pool of worker threads, starting at the tile
+//holding the render focus and spiralling outward.
+//Recognized polynomial formulas are iterated in the cheapest number type resolving adjacent pixels, see precision.h.
+//Deep zooms into z^k+c beyond double precision are rendered using perturbation theory, see perturbation.h.
 
 class MandelbrotSet : public QObject
 {
@@ -41,38 +157,230 @@ class MandelbrotSet : public QObject
 
 public:
     enum ErrorCodes {FORMULA_PARSE_ERROR=1,PALETTE_XFORMULA_PARSE_ERROR=2,PALETTE_YFORMULA_PARSE_ERROR=4};
-    MandelbrotSet(): QObject(), errorCode_(0), cancel_(false) {
-        parser_.setMathEval(&eval_);
-        paletteXparser_.setMathEval(&paletteXeval_);
-        paletteYparser_.setMathEval(&paletteYeval_);
-    }
-    ~MandelbrotSet() {}
-    void cancel() {++cancel_;}
+    MandelbrotSet();
+    ~MandelbrotSet();
+    //cancels the current render and all queued ones, thread safe. returns the generation requests replacing them need.
+    qint32 cancel() {return generation_.fetchAndAddOrdered(1)+1;}
+    qint32 generation() const {return generation_.load();}
+    //true if the batch compiler accepts the formula and its program agrees with the interpreter at a set of probe points
+    static bool batchMatchesInterpreter(const QString& formula);
 public slots:
+    void render(RenderRequest request);
+    void recolor(qint32 generation);
     void renderMandelbrot(double xCenter,double yCenter, qint32 width, qint32 height, double scale, qint32 nIterations, double limit, qint32 nPasses);
     void renderJulia(double xCenter,double yCenter, qint32 width, qint32 height, double scale, qint32 nIterations, double limit, qint32 nPasses, double cRe, double cIm);
+    void renderExponentialMap(double xCenter,double yCenter, qint32 width, qint32 height, double radius, qint32 nIterations, double limit, qint32 nPasses);
     void setColorPalette(QImage colorPalette) {colorPalette_=colorPalette;}
-    void parseFormula(QString str) {parser_.setString(str); if(!parser_.parse()) {errorCode_|=FORMULA_PARSE_ERROR;} else {errorCode_&=~FORMULA_PARSE_ERROR;}}
-    void parsePaletteXFormula(QString str) {paletteXparser_.setString(str); if(!paletteXparser_.parse()) {errorCode_|=PALETTE_XFORMULA_PARSE_ERROR;} else {errorCode_&=~PALETTE_XFORMULA_PARSE_ERROR;}}
-    void parsePaletteYFormula(QString str) {paletteYparser_.setString(str); if(!paletteYparser_.parse()) {errorCode_|=PALETTE_YFORMULA_PARSE_ERROR;} else {errorCode_&=~PALETTE_YFORMULA_PARSE_ERROR;}}
+    void parseFormula(QString str);
+    void parsePaletteXFormula(QString str);
+    void parsePaletteYFormula(QString str);
     void setCol0Interior(bool b) {col0Interior_=b;}
     void setRow0Interior(bool b) {row0Interior_=b;}
+    void setThreadCount(qint32 n);
+    //only compute rectangle borders and fill rectangles with uniform borders, see subdivide()
+    void setSubdivision(bool b) {subdivision_=b;}
+    //samples per anti-aliased pixel (1 turns anti-aliasing off), color difference to a neighbor which marks a pixel
+    //for anti-aliasing, and extra samples per frame as a multiple of its pixel count
+    void setAntialiasing(qint32 samples,qint32 threshold,double budget) {antialiasSamples_=samples;antialiasThreshold_=threshold;antialiasBudget_=budget;}
+    void setTileCacheBudget(qint32 megabytes) {tileCache_.setBudget((size_t)megabytes*1024*1024);}
+    //pixel the tiles of the following renders are ordered around, the view center if negative
+    void setRenderFocus(qint32 x,qint32 y) {focusX_=x;focusY_=y;}
 signals:
-    void imageOut(QImage image);
+    //generation of the request the image belongs to
+    void imageOut(QImage image,qint32 generation);
+    //a finished tile of the current pass at position x,y of the image, only sent if connected
+    void tileOut(QImage tile,qint32 x,qint32 y,qint32 generation);
     void errorCodeOut(qint32 errorCode);
     void linesRendered(qint32 lines);
+    //number type the current render iterates in
+    void precisionOut(QString precision);
+    //iterations per pixel replaced by the series approximation in the last pass of a deep zoom
+    void seriesSkipOut(qint32 iterations);
+    //percentage of the pixels the last pass computed rather than filled in subdivision mode
+    void computedPixelsOut(double percent);
+    //full tiles of the last render found in the tile cache and computed
+    void tileCacheOut(qint32 hits,qint32 misses);
+    //sent at the end of every pass, including passes the iteration buffer already covered, the last pass includes anti-aliasing
+    void statsOut(RenderStats stats);
+private:
+    class TileWorker;
+    struct Tile
+    {
+        qint32 x,y,width,height;
+    };
+    static const qint32 TILE_SIZE;
+    static const qint32 MAX_REFERENCES;
+    static const qint32 MIN_SUBDIVISION_SIZE;
+    static const qint32 ANTIALIAS_CHUNK_SIZE;
+    static const qint32 HISTOGRAM_BINS;
+    static const qint32 CANCEL_CHECK_ITERATIONS;
+    static const qint32 CANCEL_CHECK_ROUNDS;
+public:
+    static const qint32 DEFAULT_ANTIALIAS_SAMPLES;
+    static const qint32 DEFAULT_ANTIALIAS_THRESHOLD;
+    static const double DEFAULT_ANTIALIAS_BUDGET;
 private:
-    MathParser<std::complex<double> > parser_;
-    MathParser<double> paletteXparser_;
-    MathParser<double> paletteYparser_;
-    MathEval<std::complex<double> > eval_;
-    MathEval<double> paletteXeval_;
-    MathEval<double> paletteYeval_;
+
+    void renderView(const RenderRequest& request);
+    void selectPrecision();
+    void prepareContext(FormulaContext& context);
+    void runTiles(qint32 progressOffset);
+    void orderTiles();
+    void deliverTile(const Tile& tile);
+    bool findGlitchedPixel(qint32& x,qint32& y);
+    void computeReference(qint32 x,qint32 y);
+    //smallest distance of adjacent pixels of the current request
+    FloatExp pixelSpacing() const;
+    //offset of a pixel to the view center, and to the current reference, in units of 2^offsetExponent_
+    void pixelOffset(qint32 ix,qint32 iy,double& dx,double& dy) const
+    {
+        const RenderRequest& r=request_;
+        if(r.exponential)
+        {
+            dx=expRadius_[iy]*expCos_[ix];
+            dy=expRadius_[iy]*expSin_[ix];
+        }
+        else
+        {
+            dx=(ix-r.width/2)*offsetScale_;
+            dy=(iy-r.height/2)*offsetScale_;
+        }
+    }
+    //offset of a point given in fractional pixels to the view center, in units of 2^offsetExponent_
+    void sampleOffset(double fx,double fy,double& dx,double& dy) const;
+    void referenceOffset(qint32 ix,qint32 iy,double& dx,double& dy) const
+    {
+        if(request_.exponential)
+        {
+            pixelOffset(ix,iy,dx,dy);
+            dx-=referenceOffsetX_;
+            dy-=referenceOffsetY_;
+        }
+        else
+        {
+            dx=(ix-referenceX_)*offsetScale_;
+            dy=(iy-referenceY_)*offsetScale_;
+        }
+    }
+    void computeSeries();
+    void loadTile(const Tile& tile,const TileCache::Tile& cached);
+    void storeTile(const Tile& tile,const TileCache::Key& key);
+    void renderTiles(FormulaContext& context);
+    void renderTile(FormulaContext& context,const Tile& tile);
+    void subdivide(FormulaContext& context,const Tile& tile,qint32 x,qint32 y,qint32 w,qint32 h);
+    void renderPixels(FormulaContext& context);
+    void preparePaletteTable();
+    void colorPixels(FormulaContext& context);
+    //gathers the statistics of the pass from the iteration buffer and the contexts, which are reset for the next pass
+    RenderStats passStats(qint32 pass,double seconds);
+    //adds jittered samples to the pixels of the finished image which differ most from their neighbors
+    bool antialias();
+    void antialiasPixels(FormulaContext& context,qint32 begin,qint32 end);
+    //iterates the gathered pixels in slices of about CANCEL_CHECK_ITERATIONS iterations and stops early once
+    //cancelled, returns the number of pixels iterated, which are the first ones
+    qint32 iterateSlices(FormulaContext& context,qint32 count);
+    void iterateRow(FormulaContext& context,qint32 first,qint32 count);
+    void iterateRowBatched(FormulaContext& context,qint32 first,qint32 count);
+    void paletteCoordinates(FormulaContext& context,double zr,double zi,double u,double v,qint32 it,double& xPal,double& yPal);
+    QRgb paletteColor(FormulaContext& context,double zr,double zi,double u,double v,qint32 it,bool interior);
+
+    //formula strings, every change increments formulaRevision_ so worker contexts know to parse them again
+    QString formula_;
+    QString paletteFormulaX_;
+    QString paletteFormulaY_;
+    qint32 formulaRevision_;
+    //compiled kernel for recognized formulas, 0 if the formula is run by the interpreter
+    EscapeKernel kernel_;
+    //single precision and double-double variants of kernel_, the periodic ones detect cycles
+    EscapeKernel floatKernel_;
+    EscapeKernel periodicKernel_;
+    EscapeKernel periodicFloatKernel_;
+    DoubleDoubleKernel doubleDoubleKernel_;
+    //vectorized kernel for z^2+c, 0 for any other formula
+    BatchEscapeKernel batchKernel_;
+    BatchEscapeKernel floatBatchKernel_;
+    //lane-wise compiled formula, used for formulas without a dedicated kernel. invalid if the formula
+    //uses anything the batch compiler doesn't support or evaluates differently, in which case the interpreter is used.
+    BatchProgram batchProgram_;
+    //perturbation kernels for z^k+c, 0 for any other formula
+    PerturbationKernel perturbationKernel_;
+    PerturbationKernel floatExpPerturbationKernel_;
+    qint32 polynomialPower_;
+    //one context per worker thread
+    std::vector<FormulaContext*> contexts_;
+    QThreadPool pool_;
+
     qint32 errorCode_;
     QImage colorPalette_;
+    PaletteSampler paletteSampler_;
     bool col0Interior_;
     bool row0Interior_;
-    qint32 cancel_;
+    bool subdivision_;
+    qint32 antialiasSamples_;
+    qint32 antialiasThreshold_;
+    double antialiasBudget_;
+    qint32 focusX_;
+    qint32 focusY_;
+    //palette formulas only use n, m, l, w and h, see preparePaletteTable()
+    bool paletteXIterationsOnly_;
+    bool paletteYIterationsOnly_;
+    //colors indexed by the iteration count, followed by those of interior pixels, empty if not used
+    std::vector<QRgb> paletteTable_;
+    //latest generation requested and the one being rendered, a render is cancelled once they differ
+    QAtomicInt generation_;
+    qint32 renderGeneration_;
+    bool cancelled() const {return generation_.load()!=renderGeneration_;}
+
+    //iteration state of the last view rendered, complete_ is set once all of its passes are done
+    IterationBuffer iterations_;
+    bool complete_;
+    TileCache tileCache_;
+
+    //state of the pass currently being rendered, shared by all workers
+    RenderRequest request_;
+    double xCenter_;
+    double yCenter_;
+    qint32 nIt_;
+    //escape limit, lower than the requested one for deep zooms whose reference orbit can't hold it
+    double limit_;
+    Precision precision_;
+    //pixel offsets are given in units of 2^offsetExponent_, which is the exponent of the scale for deep zooms and 0
+    //otherwise. offsetUnit_ is that unit as a double, 0 where it's too small, and offsetScale_ the scale in that unit.
+    qint32 offsetExponent_;
+    double offsetUnit_;
+    double offsetScale_;
+    //view center for double-double iteration
+    DoubleDouble xCenterDD_;
+    DoubleDouble yCenterDD_;
+    //perturbation is used for the current render, deltas are taken relative to the reference at pixel referenceX_,referenceY_
+    bool deep_;
+    ReferenceOrbit reference_;
+    //series for the reference at the view center, unused for the references of glitched pixels
+    SeriesApproximation series_;
+    qint32 referenceX_;
+    qint32 referenceY_;
+    //offset of the reference to the view center in exponential maps, where pixel offsets aren't linear
+    double referenceOffsetX_;
+    double referenceOffsetY_;
+    //radius of every row in units of 2^offsetExponent_ and direction of every column of an exponential map
+    std::vector<double> expRadius_;
+    std::vector<double> expCos_;
+    std::vector<double> expSin_;
+    quint32 *imageBits_;
+    qint32 imageStride_;
+    bool col0InteriorPass_;
+    bool row0InteriorPass_;
+    //tiles are only colored from the iteration buffer, see recolor()
+    bool recoloring_;
+    //workers add samples to the pixels in antialiasPixels_ instead of rendering tiles, see antialias()
+    bool antialiasing_;
+    std::vector<qint32> antialiasPixels_;
+    std::vector<Tile> tiles_;
+    QAtomicInt nextTile_;
+    //tileOut is connected, checked once per render
+    bool deliverTiles_;
+    QAtomicInt pixelsRendered_;
+    QAtomicInt pixelsComputed_;
 };
 
 #endif // MANDELBROTSET_H
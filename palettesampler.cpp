@@ -0,0 +1,72 @@
+#include "palettesampler.h"
+
+void PaletteSampler::setPalette(const QImage &palette, bool col0Interior, bool row0Interior)
+{
+    QImage rgb=palette.convertToFormat(QImage::Format_RGB32);
+    col0Interior_=col0Interior;
+    row0Interior_=row0Interior;
+    fillTable(escaped_,rgb,(qint32)col0Interior,(qint32)row0Interior);
+    fillTable(interior_,rgb,0,0);
+}
+
+void PaletteSampler::fillTable(Table &table, const QImage &palette, qint32 x0, qint32 y0)
+{
+    table.width=palette.width()-x0;
+    table.height=palette.height()-y0;
+    table.colors.resize((size_t)(table.width+1)*(table.height+1));
+    for(qint32 y=0;y<=table.height;++y)
+    {
+        const quint32 *line=reinterpret_cast<const quint32*>(palette.constScanLine(y0+y%table.height));
+        for(qint32 x=0;x<=table.width;++x)
+            table.colors[(size_t)y*(table.width+1)+x]=line[x0+x%table.width];
+    }
+}
+
+void PaletteSampler::sample(const double *x, const double *y, const quint8 *interior, quint32 *colors, qint32 count) const
+{
+    const double upperLimit=(double)(1<<(sizeof(int)*8-2));
+    //position of the top left neighbour within its table and blend weights of the four neighbours
+    const quint32* texel[BLOCK];
+    quint32 stride[BLOCK];
+    quint32 weight[4*BLOCK];
+    for(qint32 start=0;start<count;start+=BLOCK)
+    {
+        qint32 n=(count-start<BLOCK)?count-start:BLOCK;
+        //positions within the tables and weights
+        for(qint32 k=0;k<n;++k)
+        {
+            double xPal=x[start+k],yPal=y[start+k];
+            xPal=(xPal<0 || xPal>upperLimit || xPal!=xPal)?0:xPal;
+            yPal=(yPal<0 || yPal>upperLimit || yPal!=yPal)?0:yPal;
+            const Table* table=&escaped_;
+            if(interior[start+k])
+            {
+                table=&interior_;
+                xPal=col0Interior_?0:xPal;
+                yPal=row0Interior_?0:yPal;
+            }
+            qint32 ixPal=(qint32)xPal,iyPal=(qint32)yPal;
+            quint32 fx=(quint32)((xPal-ixPal)*256.+0.5),fy=(quint32)((yPal-iyPal)*256.+0.5);
+            //palette formulas mostly stay within the palette, which saves the divisions
+            ixPal=(ixPal<table->width)?ixPal:ixPal%table->width;
+            iyPal=(iyPal<table->height)?iyPal:iyPal%table->height;
+            texel[k]=table->colors.data()+(size_t)iyPal*(table->width+1)+ixPal;
+            stride[k]=table->width+1;
+            quint32 w11=(fx*fy)>>8;
+            weight[4*k]=256-fx-fy+w11;
+            weight[4*k+1]=fx-w11;
+            weight[4*k+2]=fy-w11;
+            weight[4*k+3]=w11;
+        }
+        //red and blue, then alpha and green, are blended in the two 16 bit halves of an integer
+        for(qint32 k=0;k<n;++k)
+        {
+            const quint32 *t=texel[k];
+            const quint32 *w=weight+4*k;
+            quint32 c00=t[0],c01=t[1],c10=t[stride[k]],c11=t[stride[k]+1];
+            quint32 rb=(c00&0xff00ffu)*w[0]+(c01&0xff00ffu)*w[1]+(c10&0xff00ffu)*w[2]+(c11&0xff00ffu)*w[3];
+            quint32 ag=((c00>>8)&0xff00ffu)*w[0]+((c01>>8)&0xff00ffu)*w[1]+((c10>>8)&0xff00ffu)*w[2]+((c11>>8)&0xff00ffu)*w[3];
+            colors[start+k]=((rb>>8)&0xff00ffu)|(ag&0xff00ff00u)|0xff000000u;
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef PALETTESAMPLER_H
+#define PALETTESAMPLER_H
+
+#include <QImage>
+#include <vector>
+
+//Bilinear sampling of the color palette in 8.8 fixed point. The palette is converted once per render into tables
+//padded by one column and row holding the wrapped around colors, so the four neighbours of a sample are read without
+//further modulo operations. Colors are blended two channels per 32 bit integer with weights summing to 256, the loop
+//over the samples of a row is simple enough for the compiler to vectorize.
+
+class PaletteSampler
+{
+public:
+    PaletteSampler(): col0Interior_(false), row0Interior_(false) {}
+    //col0Interior, row0Interior reserve the first column or row of the palette for interior pixels
+    void setPalette(const QImage& palette,bool col0Interior,bool row0Interior);
+    //colors of count samples at palette coordinates x,y as computed by the palette formulas. coordinates which are
+    //negative, too large or not a number are replaced by 0. interior marks samples of pixels which didn't escape.
+    void sample(const double* x,const double* y,const quint8* interior,quint32* colors,qint32 count) const;
+private:
+    //palette area of width*height colors, stored with a padding column and row of (width+1)*(height+1) colors
+    struct Table
+    {
+        std::vector<quint32> colors;
+        qint32 width,height;
+    };
+    static void fillTable(Table& table,const QImage& palette,qint32 x0,qint32 y0);
+    //tables for escaped pixels, which exclude reserved columns and rows, and for interior ones
+    Table escaped_;
+    Table interior_;
+    bool col0Interior_;
+    bool row0Interior_;
+    //samples are processed in blocks of this size
+    static const qint32 BLOCK=64;
+};
+
+#endif // PALETTESAMPLER_H
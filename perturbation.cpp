@@ -0,0 +1,121 @@
+#include "perturbation.h"
+
+void ReferenceOrbit::compute(const BigFixed &z0Re, const BigFixed &z0Im, const BigFixed &cRe, const BigFixed &cIm, qint32 power, qint32 nIt, double limit, qint32 precision,
+                             const std::function<bool()> &cancelled)
+{
+    limit=qMin(limit,maxReferenceLimit(power));
+    BigFixed re=z0Re.withPrecision(precision),im=z0Im.withPrecision(precision);
+    BigFixed cr=cRe.withPrecision(precision),ci=cIm.withPrecision(precision);
+    zr.clear();
+    zi.clear();
+    zr.reserve(nIt+1);
+    zi.reserve(nIt+1);
+    for(qint32 n=0;;++n)
+    {
+        double r=re.toDouble(),i=im.toDouble();
+        zr.push_back(r);
+        zi.push_back(i);
+        if(n>=nIt || r*r+i*i>limit)
+            break;
+        if(cancelled && !((n+1)%CANCEL_CHECK_ITERATIONS) && cancelled())
+            break;
+        BigFixed pr=re,pi=im;
+        for(qint32 k=1;k<power;++k)
+        {
+            BigFixed tmp=pr*re-pi*im;
+            pi=pr*im+pi*re;
+            pr=tmp;
+        }
+        re=pr+cr;
+        im=pi+ci;
+    }
+}
+
+void SeriesApproximation::compute(const ReferenceOrbit &orbit, PerturbationKernel kernel, qint32 power, bool julia, const std::vector<std::complex<double> > &probes, qint32 exponent, qint32 nIt, double limit,
+                                  const std::function<bool()> &cancelled)
+{
+    typedef std::complex<double> Complex;
+    double radius=0.;
+    for(size_t i=0;i<probes.size();++i)
+        radius=qMax(radius,std::abs(probes[i]));
+    //coefficients of every iteration the truncation estimate accepts, so the probes can fall back to fewer
+    std::vector<Complex> as(1,julia?1.:0.),bs(1,0.),cs(1,0.);
+    const double b2=power*(power-1)/2.,b3=power*(power-1)*(power-2)/6.;
+    const qint32 length=(qint32)orbit.zr.size();
+    for(qint32 n=0;n<nIt && n+2<length;++n)
+    {
+        Complex Z(orbit.zr[n],orbit.zi[n]);
+        //Z^(power-3), Z^(power-2), Z^(power-1), with negative powers never being used
+        Complex z3=power>=3?std::pow(Z,power-3):0.,z2=power>=3?z3*Z:1.,z1=z2*Z;
+        const Complex &a=as.back(),&b=bs.back(),&c=cs.back();
+        //A_n*2^exponent, how far a unit offset moves dz
+        Complex scaledA(std::ldexp(a.real(),exponent),std::ldexp(a.imag(),exponent));
+        Complex nextA=(double)power*z1*a+(julia?0.:1.);
+        Complex nextB=(double)power*z1*b+b2*z2*a*scaledA;
+        Complex nextC=(double)power*z1*c+b2*z2*2.*b*scaledA+b3*z3*a*scaledA*scaledA;
+        double errorTerm=std::abs(nextC)*radius*radius*radius,mainTerm=std::abs(nextA)*radius;
+        //A_n has to stay within the range of double, which plain comparisons catch even under -Ofast
+        if(!(errorTerm<=SERIES_TOLERANCE*mainTerm) || !std::isfinite(errorTerm) || !(mainTerm<1e300))
+            break;
+        as.push_back(nextA);
+        bs.push_back(nextB);
+        cs.push_back(nextC);
+    }
+    skip=(qint32)as.size()-1;
+    //halve skip until all probes end up with the same iteration count as without the series
+    for(;skip>0;skip/=2)
+    {
+        a=as[skip];
+        b=bs[skip];
+        c=cs[skip];
+        bool valid=true;
+        for(size_t i=0;i<probes.size() && valid;++i)
+        {
+            if(cancelled && cancelled())
+            {
+                skip=0;
+                return;
+            }
+            double dr=probes[i].real(),di=probes[i].imag();
+            double dcr=julia?0.:dr,dci=julia?0.:di;
+            double zr=julia?dr:0.,zi=julia?di:0.;
+            bool glitched,seriesGlitched;
+            qint32 n=kernel(orbit,zr,zi,dcr,dci,exponent,0,nIt,limit,glitched);
+            evaluate(dr,di,zr,zi);
+            qint32 seriesN=kernel(orbit,zr,zi,dcr,dci,exponent,skip,nIt,limit,seriesGlitched);
+            valid=glitched || (!seriesGlitched && n==seriesN);
+        }
+        if(valid)
+            return;
+    }
+}
+
+namespace
+{
+
+template<typename T> PerturbationKernel selectKernel(qint32 power)
+{
+    switch(power)
+    {
+    case 2: return &perturbationKernel<T,2>;
+    case 3: return &perturbationKernel<T,3>;
+    case 4: return &perturbationKernel<T,4>;
+    case 5: return &perturbationKernel<T,5>;
+    case 6: return &perturbationKernel<T,6>;
+    case 7: return &perturbationKernel<T,7>;
+    case 8: return &perturbationKernel<T,8>;
+    default: return 0;
+    }
+}
+
+}
+
+PerturbationKernel selectPerturbationKernel(qint32 power)
+{
+    return selectKernel<double>(power);
+}
+
+PerturbationKernel selectFloatExpPerturbationKernel(qint32 power)
+{
+    return selectKernel<FloatExp>(power);
+}
@@ -0,0 +1,164 @@
+#ifndef PERTURBATION_H
+#define PERTURBATION_H
+
+#include "bigfixed.h"
+#include "floatexp.h"
+#include <cmath>
+#include <complex>
+#include <functional>
+#include <vector>
+
+//Perturbation theory for deep zooms into the sets of z^k+c. A single reference orbit Z is computed in high
+//precision and stored as doubles, every pixel then only iterates its small difference dz to the reference:
+//z^k+c-(Z^k+C) = sum_{j=1..k} binomial(k,j)*Z^(k-j)*dz^j + dc
+//Pixels whose orbit comes too close to zero relative to the reference lose all precision in dz ("glitches"),
+//they are detected and have to be rendered again using a different reference.
+
+struct ReferenceOrbit
+{
+    //Z_0 up to the iteration where the reference escaped or the requested number of iterations was reached
+    std::vector<double> zr,zi;
+    //computes the orbit of z0 under z^power+c with the given number of fraction bits, limit is lowered to
+    //maxReferenceLimit(power). cancelled is polled every CANCEL_CHECK_ITERATIONS iterations, the orbit stops short
+    //once it returns true.
+    void compute(const BigFixed& z0Re,const BigFixed& z0Im,const BigFixed& cRe,const BigFixed& cIm,qint32 power,qint32 nIt,double limit,qint32 precision,
+                 const std::function<bool()>& cancelled=std::function<bool()>());
+    static const qint32 CANCEL_CHECK_ITERATIONS=256;
+};
+
+//largest escape limit the orbit of z^power+c can be computed for. BigFixed has a 64 bit integer part, which holds
+//Z^power and the products leading to it as long as |Z|^2<=2^(126/power).
+inline double maxReferenceLimit(qint32 power)
+{
+    return std::pow(2.,126./power);
+}
+
+//iterates dz starting from the given delta to the reference orbit at iteration start, with dc the difference of c to
+//the reference. both are given in units of 2^exponent, which keeps them within the range of double at any scale.
+//returns the number of iterations, on return dzr,dzi hold the full value z=Z+dz. glitched is set if the
+//pixel lost precision or outlived the reference orbit and has to be iterated again with a different reference.
+typedef qint32 (*PerturbationKernel)(const ReferenceOrbit& orbit,double& dzr,double& dzi,double dcr,double dci,qint32 exponent,qint32 start,qint32 nIt,double limit,bool& glitched);
+
+//kernel for z^power+c, 0 if there is none. the FloatExp variant keeps deltas too small for the exponent range of double
+PerturbationKernel selectPerturbationKernel(qint32 power);
+PerturbationKernel selectFloatExpPerturbationKernel(qint32 power);
+
+//Truncated series dz_n = A_n*d+B_n*d^2+C_n*d^3 in the offset d of a pixel to the reference, d being dc for the
+//Mandelbrot set and dz_0 for Julia sets. The coefficients only depend on the reference orbit, so all pixels of a view
+//can start iterating at skip instead of 0 as long as the truncated terms stay negligible.
+//Offsets and dz are in units of 2^exponent like the deltas of the kernels, so b and c hold B_n*2^exponent and
+//C_n*2^(2*exponent). The series ends where A_n leaves the range of double.
+struct SeriesApproximation
+{
+    //number of iterations replaced by the series, 0 if it doesn't hold for any
+    qint32 skip;
+    std::complex<double> a,b,c;
+    SeriesApproximation(): skip(0) {}
+    //finds the largest skip for which the series holds. probes are offsets at the border of the view, which are
+    //additionally iterated with and without the series to catch cases the truncation estimate misses.
+    //cancelled is polled between probes, skip is 0 once it returns true.
+    void compute(const ReferenceOrbit& orbit,PerturbationKernel kernel,qint32 power,bool julia,const std::vector<std::complex<double> >& probes,qint32 exponent,qint32 nIt,double limit,
+                 const std::function<bool()>& cancelled=std::function<bool()>());
+    //dz after skip iterations for the offset d
+    void evaluate(double dr,double di,double& dzr,double& dzi) const
+    {
+        std::complex<double> d(dr,di);
+        std::complex<double> dz=((c*d+b)*d+a)*d;
+        dzr=dz.real();
+        dzi=dz.imag();
+    }
+};
+
+//the series is truncated once |C_n|*r^3 exceeds SERIES_TOLERANCE*|A_n|*r, r being the largest offset in the view
+const double SERIES_TOLERANCE=1e-12;
+
+//Pauldelbrot's criterion: |Z+dz|^2 < GLITCH_TOLERANCE*|Z|^2
+const double GLITCH_TOLERANCE=1e-6;
+
+//v*2^exponent in the type of the deltas
+template<typename T> inline T scaledDelta(double v,qint32 exponent);
+
+template<> inline double scaledDelta<double>(double v,qint32 exponent)
+{
+    return std::ldexp(v,exponent);
+}
+
+template<> inline FloatExp scaledDelta<FloatExp>(double v,qint32 exponent)
+{
+    return FloatExp(v,exponent);
+}
+
+//dz=z^K-Z^K for z=Z+dz, T being the type of the deltas
+template<typename T,int K> struct PerturbationStep
+{
+    static inline void apply(double Zr,double Zi,T& dr,T& di)
+    {
+        //Horner's scheme in d: d*(binomial(K,1)*Z^(K-1)+d*(binomial(K,2)*Z^(K-2)+...+d))
+        double powRe[K],powIm[K];
+        powRe[0]=1.;
+        powIm[0]=0.;
+        for(qint32 m=1;m<K;++m)
+        {
+            powRe[m]=powRe[m-1]*Zr-powIm[m-1]*Zi;
+            powIm[m]=powRe[m-1]*Zi+powIm[m-1]*Zr;
+        }
+        T rr=1.,ri=0.;
+        double binomial=1.;
+        for(qint32 j=K-1;j>=1;--j)
+        {
+            binomial=binomial*(j+1)/(K-j);
+            T tr=rr*dr-ri*di+T(binomial*powRe[K-j]);
+            ri=rr*di+ri*dr+T(binomial*powIm[K-j]);
+            rr=tr;
+        }
+        T tr=rr*dr-ri*di;
+        di=rr*di+ri*dr;
+        dr=tr;
+    }
+};
+
+template<typename T> struct PerturbationStep<T,2>
+{
+    static inline void apply(double Zr,double Zi,T& dr,T& di)
+    {
+        //(2Z+d)*d
+        T tr=T(2.*Zr)+dr,ti=T(2.*Zi)+di;
+        T nr=tr*dr-ti*di;
+        di=tr*di+ti*dr;
+        dr=nr;
+    }
+};
+
+template<typename T,int K> qint32 perturbationKernel(const ReferenceOrbit& orbit,double& dzr,double& dzi,double dcr,double dci,qint32 exponent,qint32 start,qint32 nIt,double limit,bool& glitched)
+{
+    const double *refRe=orbit.zr.data(),*refIm=orbit.zi.data();
+    const qint32 length=(qint32)orbit.zr.size();
+    T dr=scaledDelta<T>(dzr,exponent),di=scaledDelta<T>(dzi,exponent);
+    const T cr=scaledDelta<T>(dcr,exponent),ci=scaledDelta<T>(dci,exponent);
+    double zr,zi;
+    qint32 n=start;
+    glitched=false;
+    for(;;)
+    {
+        double Zr=refRe[n],Zi=refIm[n];
+        zr=Zr+(double)dr;
+        zi=Zi+(double)di;
+        double mag=zr*zr+zi*zi;
+        if(n>=nIt || mag>limit)
+            break;
+        if(mag<GLITCH_TOLERANCE*(Zr*Zr+Zi*Zi) || n+1>=length)
+        {
+            glitched=true;
+            break;
+        }
+        PerturbationStep<T,K>::apply(Zr,Zi,dr,di);
+        dr=dr+cr;
+        di=di+ci;
+        ++n;
+    }
+    dzr=zr;
+    dzi=zi;
+    return n;
+}
+
+#endif // PERTURBATION_H
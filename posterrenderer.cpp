@@ -0,0 +1,162 @@
+#include "posterrenderer.h"
+#include "configio.h"
+#include <QSaveFile>
+#include <QTextStream>
+#include <vector>
+
+const qint32 PosterRenderer::DEFAULT_MEMORY_BUDGET=512;
+const qint32 PosterRenderer::BYTES_PER_PIXEL=2*sizeof(double)+sizeof(qint32)+sizeof(quint8)+sizeof(quint32);
+
+PosterRenderer::PosterRenderer(): QObject(), engine_(new MandelbrotSet), errorCode_(0), cancel_(0)
+{
+    qRegisterMetaType<PosterRequest>("PosterRequest");
+    engine_->setParent(this);
+    //bands never come back, so there is nothing worth caching
+    engine_->setTileCacheBudget(0);
+    //the engine runs synchronously inside render, so its signals are handled right away
+    QObject::connect(engine_,&MandelbrotSet::errorCodeOut,[this](qint32 errorCode){errorCode_=errorCode;});
+    QObject::connect(engine_,&MandelbrotSet::imageOut,[this](QImage image){band_=image;});
+}
+
+qint32 PosterRenderer::bandHeight(qint32 width, qint32 height, qint32 memoryBudget)
+{
+    qint64 rows=(qint64)memoryBudget*1024*1024/((qint64)width*BYTES_PER_PIXEL);
+    return (qint32)qBound((qint64)1,rows,(qint64)height);
+}
+
+void PosterRenderer::render(PosterRequest request)
+{
+    cancel_.store(0);
+    const MandelbrotConfig& config=request.config;
+    engine_->parseFormula(config.formula);
+    engine_->setColorPalette(request.colorPalette);
+    engine_->parsePaletteXFormula(config.paletteFormulaX);
+    engine_->parsePaletteYFormula(config.paletteFormulaY);
+    engine_->setCol0Interior(config.col0interior);
+    engine_->setRow0Interior(config.row0interior);
+
+    QString sig=signature(request);
+    QFile file(request.fileName);
+    qint32 rows=openOutput(file,request,sig);
+    if(rows<0)
+    {
+        emit finished(POSTER_WRITE_ERROR);
+        return;
+    }
+    emit rowsWritten(rows);
+    qint32 bandRows=bandHeight(request.width,request.height,request.memoryBudget);
+    while(rows<request.height)
+    {
+        if(cancel_.load())
+        {
+            emit finished(POSTER_CANCELED);
+            return;
+        }
+        //band centers are whole pixels apart from the poster's center, so bands continue the same pixel grid
+        qint32 h=qMin(bandRows,request.height-rows);
+        BigFixed yCenter=config.centerY+BigFixed((rows+h/2-request.height/2)*config.scale);
+        RenderRequest bandRequest={config.centerX,yCenter,request.width,h,config.scale,config.nIterations,config.limit,1,config.julia,config.juliaRe,config.juliaIm,false,engine_->generation()};
+        band_=QImage();
+        engine_->render(bandRequest);
+        if(errorCode_)
+        {
+            emit errorCodeOut(errorCode_);
+            emit finished(POSTER_PARSE_ERROR);
+            return;
+        }
+        if(band_.isNull())
+        {
+            emit finished(POSTER_CANCELED);
+            return;
+        }
+        if(!writeBand(file,band_))
+        {
+            emit finished(POSTER_WRITE_ERROR);
+            return;
+        }
+        rows+=h;
+        if(!writeCheckpoint(checkpointFileName(request.fileName),sig,rows))
+        {
+            emit finished(POSTER_WRITE_ERROR);
+            return;
+        }
+        emit rowsWritten(rows);
+    }
+    band_=QImage();
+    file.close();
+    QFile::remove(checkpointFileName(request.fileName));
+    emit finished(POSTER_COMPLETE);
+}
+
+qint32 PosterRenderer::openOutput(QFile &file, const PosterRequest &request, const QString &signature)
+{
+    QByteArray header=ppmHeader(request);
+    qint64 rowBytes=(qint64)request.width*3;
+    //resume if the checkpoint belongs to the same poster and the file holds the rows it claims
+    QFile checkpoint(checkpointFileName(request.fileName));
+    if(checkpoint.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QTextStream in(&checkpoint);
+        QString sig=in.readLine();
+        bool ok;
+        qint32 rows=in.readLine().toInt(&ok);
+        checkpoint.close();
+        if(ok && sig==signature && rows>=0 && rows<=request.height && file.exists() && file.size()>=header.size()+rows*rowBytes &&
+                file.open(QIODevice::ReadWrite))
+        {
+            if(file.resize(header.size()+rows*rowBytes) && file.seek(header.size()+rows*rowBytes))
+                return rows;
+            file.close();
+        }
+    }
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(header)!=header.size())
+        return -1;
+    return 0;
+}
+
+bool PosterRenderer::writeBand(QFile &file, const QImage &band)
+{
+    //RGB32 rows are repacked to the 3 bytes per pixel of PPM
+    std::vector<char> row((size_t)band.width()*3);
+    for(qint32 y=0;y<band.height();++y)
+    {
+        const quint32* pixels=reinterpret_cast<const quint32*>(band.constScanLine(y));
+        for(qint32 x=0;x<band.width();++x)
+        {
+            row[3*x]=(char)qRed(pixels[x]);
+            row[3*x+1]=(char)qGreen(pixels[x]);
+            row[3*x+2]=(char)qBlue(pixels[x]);
+        }
+        if(file.write(row.data(),row.size())!=(qint64)row.size())
+            return false;
+    }
+    //rows have to be on disk before the checkpoint claims them
+    return file.flush();
+}
+
+bool PosterRenderer::writeCheckpoint(const QString &fileName, const QString &signature, qint32 rows)
+{
+    //QSaveFile replaces the old checkpoint only once the new one is complete
+    QSaveFile checkpoint(fileName);
+    if(!checkpoint.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&checkpoint);
+    out<<signature<<"\n"<<rows<<"\n";
+    out.flush();
+    return checkpoint.commit();
+}
+
+QString PosterRenderer::signature(const PosterRequest &request)
+{
+    //everything which changes the pixels of the poster
+    const MandelbrotConfig& c=request.config;
+    return QString("%1x%2|%3|%4|%5,%6|%7|%8|%9|").arg(request.width).arg(request.height).arg(c.formula).arg(c.limit,0,'g',17)
+            .arg(coordinateToString(c.centerX,c.scale)).arg(coordinateToString(c.centerY,c.scale)).arg(c.scale.toString(17)).arg(c.nIterations).arg(c.julia)+
+            QString("%1,%2|%3|%4|%5|%6|%7").arg(c.juliaRe,0,'g',17).arg(c.juliaIm,0,'g',17).arg(c.colorPaletteFileName)
+            .arg(c.paletteFormulaX).arg(c.col0interior).arg(c.paletteFormulaY).arg(c.row0interior);
+}
+
+QByteArray PosterRenderer::ppmHeader(const PosterRequest &request)
+{
+    return QString("P6\n%1 %2\n255\n").arg(request.width).arg(request.height).toLatin1();
+}
@@ -0,0 +1,63 @@
+#ifndef POSTERRENDERER_H
+#define POSTERRENDERER_H
+
+#include <QObject>
+#include <QImage>
+#include <QString>
+#include <QFile>
+#include <QAtomicInt>
+#include "mandelbrotset.h"
+
+//Renders images too large for memory, e.g. print posters, in horizontal bands within a memory budget.
+//Every finished band is appended to a binary PPM file right away, and the number of rows on disk is kept
+//in a checkpoint file next to it, so an interrupted poster continues where it stopped when rendered again.
+
+struct PosterRequest
+{
+    //config.scale is the scale of the poster's pixels
+    MandelbrotConfig config;
+    QImage colorPalette;
+    qint32 width;
+    qint32 height;
+    QString fileName;
+    //megabytes of image and iteration state per band
+    qint32 memoryBudget;
+};
+
+Q_DECLARE_METATYPE(PosterRequest)
+
+class PosterRenderer : public QObject
+{
+    Q_OBJECT
+public:
+    enum Results {POSTER_COMPLETE=0,POSTER_CANCELED=1,POSTER_PARSE_ERROR=2,POSTER_WRITE_ERROR=3};
+    static const qint32 DEFAULT_MEMORY_BUDGET;
+    //memory per pixel of a band: image plus iteration state
+    static const qint32 BYTES_PER_PIXEL;
+    PosterRenderer();
+    void cancel() {cancel_.store(1);engine_->cancel();}
+    //rows per band so a band fits the budget, at least one
+    static qint32 bandHeight(qint32 width,qint32 height,qint32 memoryBudget);
+    static QString checkpointFileName(const QString& fileName) {return fileName+".checkpoint";}
+public slots:
+    void render(PosterRequest request);
+    void setThreadCount(qint32 n) {engine_->setThreadCount(n);}
+signals:
+    void rowsWritten(qint32 rows);
+    void errorCodeOut(qint32 errorCode);
+    void finished(qint32 result);
+private:
+    //opens the output, continuing after the rows of a matching checkpoint, returns the number of rows already written or -1
+    qint32 openOutput(QFile& file,const PosterRequest& request,const QString& signature);
+    bool writeBand(QFile& file,const QImage& band);
+    bool writeCheckpoint(const QString& fileName,const QString& signature,qint32 rows);
+    static QString signature(const PosterRequest& request);
+    static QByteArray ppmHeader(const PosterRequest& request);
+    //owned through the QObject parent, so it moves to the poster thread with this object
+    MandelbrotSet* engine_;
+    QImage band_;
+    qint32 errorCode_;
+    QAtomicInt cancel_;
+};
+
+#endif // POSTERRENDERER_H
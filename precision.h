@@ -0,0 +1,31 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+
+#include "floatexp.h"
+
+//Number types the escape time loop can run in, from cheapest to most precise. Each render uses the cheapest one
+//which still resolves adjacent pixels at the requested scale.
+enum Precision {PRECISION_FLOAT,PRECISION_DOUBLE,PRECISION_DOUBLE_DOUBLE,PRECISION_FLOATEXP};
+
+//smallest pixel spacing relative to the magnitude of the view coordinates the respective type is used for
+const double FLOAT_MIN_SPACING=1e-5;
+const double DOUBLE_MIN_SPACING=1e-13;
+//perturbation deltas are kept in FloatExp below this scale
+const double FLOATEXP_MAX_SCALE=1e-290;
+//smallest pixel spacing that can be rendered, about 5e-3011, smaller scales are raised to it. the reference orbit
+//needs a fraction bit per halving of the scale, so renders get slow long before reaching it.
+const FloatExp MIN_SCALE(1.,-10000);
+
+inline const char* precisionName(Precision precision)
+{
+    switch(precision)
+    {
+    case PRECISION_FLOAT: return "float";
+    case PRECISION_DOUBLE: return "double";
+    case PRECISION_DOUBLE_DOUBLE: return "double-double";
+    case PRECISION_FLOATEXP: return "floatexp";
+    }
+    return "";
+}
+
+#endif // PRECISION_H
@@ -0,0 +1,216 @@
+#include "simdkernels.h"
+#include "formulakernels.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MANDELBROT_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+void quadraticScalar(double* zr,double* zi,const double* cr,const double* ci,qint32* it,qint32 count,qint32 nIt,double limit)
+{
+    for(qint32 k=0;k<count;++k)
+        it[k]=polynomialKernel<double,2>(zr[k],zi[k],cr[k],ci[k],nIt,limit);
+}
+
+void quadraticFloatScalar(double* zr,double* zi,const double* cr,const double* ci,qint32* it,qint32 count,qint32 nIt,double limit)
+{
+    for(qint32 k=0;k<count;++k)
+        it[k]=polynomialKernel<float,2>(zr[k],zi[k],cr[k],ci[k],nIt,limit);
+}
+
+#ifdef MANDELBROT_X86_SIMD
+
+//no FMA, so lanes round exactly like the scalar kernel
+__attribute__((target("avx2")))
+void quadraticAvx2(double* zr,double* zi,const double* cr,const double* ci,qint32* it,qint32 count,qint32 nIt,double limit)
+{
+    const qint32 LANES=4;
+    qint32 k=0;
+    const __m256d lim=_mm256_set1_pd(limit);
+    const __m256d one=_mm256_set1_pd(1.);
+    for(;k+LANES<=count;k+=LANES)
+    {
+        __m256d r=_mm256_loadu_pd(zr+k),i=_mm256_loadu_pd(zi+k);
+        const __m256d cRe=_mm256_loadu_pd(cr+k),cIm=_mm256_loadu_pd(ci+k);
+        __m256d n=_mm256_setzero_pd();
+        for(qint32 step=0;step<nIt;++step)
+        {
+            __m256d rr=_mm256_mul_pd(r,r),ii=_mm256_mul_pd(i,i);
+            __m256d active=_mm256_cmp_pd(_mm256_add_pd(rr,ii),lim,_CMP_LE_OQ);
+            if(!_mm256_movemask_pd(active))
+                break;
+            __m256d ri=_mm256_mul_pd(r,i);
+            __m256d nr=_mm256_add_pd(_mm256_sub_pd(rr,ii),cRe);
+            __m256d ni=_mm256_add_pd(_mm256_add_pd(ri,ri),cIm);
+            r=_mm256_blendv_pd(r,nr,active);
+            i=_mm256_blendv_pd(i,ni,active);
+            n=_mm256_add_pd(n,_mm256_and_pd(active,one));
+        }
+        _mm256_storeu_pd(zr+k,r);
+        _mm256_storeu_pd(zi+k,i);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(it+k),_mm256_cvtpd_epi32(n));
+    }
+    quadraticScalar(zr+k,zi+k,cr+k,ci+k,it+k,count-k,nIt,limit);
+}
+
+__attribute__((target("avx512f")))
+void quadraticAvx512(double* zr,double* zi,const double* cr,const double* ci,qint32* it,qint32 count,qint32 nIt,double limit)
+{
+    const qint32 LANES=8;
+    qint32 k=0;
+    const __m512d lim=_mm512_set1_pd(limit);
+    const __m512d one=_mm512_set1_pd(1.);
+    for(;k+LANES<=count;k+=LANES)
+    {
+        __m512d r=_mm512_loadu_pd(zr+k),i=_mm512_loadu_pd(zi+k);
+        const __m512d cRe=_mm512_loadu_pd(cr+k),cIm=_mm512_loadu_pd(ci+k);
+        __m512d n=_mm512_setzero_pd();
+        for(qint32 step=0;step<nIt;++step)
+        {
+            __m512d rr=_mm512_mul_pd(r,r),ii=_mm512_mul_pd(i,i);
+            __mmask8 active=_mm512_cmp_pd_mask(_mm512_add_pd(rr,ii),lim,_CMP_LE_OQ);
+            if(!active)
+                break;
+            __m512d ri=_mm512_mul_pd(r,i);
+            r=_mm512_mask_add_pd(r,active,_mm512_sub_pd(rr,ii),cRe);
+            i=_mm512_mask_add_pd(i,active,_mm512_add_pd(ri,ri),cIm);
+            n=_mm512_mask_add_pd(n,active,n,one);
+        }
+        _mm512_storeu_pd(zr+k,r);
+        _mm512_storeu_pd(zi+k,i);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(it+k),_mm512_cvtpd_epi32(n));
+    }
+    quadraticScalar(zr+k,zi+k,cr+k,ci+k,it+k,count-k,nIt,limit);
+}
+
+//single precision lanes are converted from and to double through a small buffer, which is negligible next to the loop
+__attribute__((target("avx2")))
+void quadraticFloatAvx2(double* zr,double* zi,const double* cr,const double* ci,qint32* it,qint32 count,qint32 nIt,double limit)
+{
+    const qint32 LANES=8;
+    qint32 k=0;
+    const __m256 lim=_mm256_set1_ps((float)limit);
+    float buffer[4][LANES];
+    for(;k+LANES<=count;k+=LANES)
+    {
+        for(qint32 l=0;l<LANES;++l)
+        {
+            buffer[0][l]=(float)zr[k+l];
+            buffer[1][l]=(float)zi[k+l];
+            buffer[2][l]=(float)cr[k+l];
+            buffer[3][l]=(float)ci[k+l];
+        }
+        __m256 r=_mm256_loadu_ps(buffer[0]),i=_mm256_loadu_ps(buffer[1]);
+        const __m256 cRe=_mm256_loadu_ps(buffer[2]),cIm=_mm256_loadu_ps(buffer[3]);
+        //counted in integer lanes, floats stop counting at 2^24
+        __m256i n=_mm256_setzero_si256();
+        for(qint32 step=0;step<nIt;++step)
+        {
+            __m256 rr=_mm256_mul_ps(r,r),ii=_mm256_mul_ps(i,i);
+            __m256 active=_mm256_cmp_ps(_mm256_add_ps(rr,ii),lim,_CMP_LE_OQ);
+            if(!_mm256_movemask_ps(active))
+                break;
+            __m256 ri=_mm256_mul_ps(r,i);
+            __m256 nr=_mm256_add_ps(_mm256_sub_ps(rr,ii),cRe);
+            __m256 ni=_mm256_add_ps(_mm256_add_ps(ri,ri),cIm);
+            r=_mm256_blendv_ps(r,nr,active);
+            i=_mm256_blendv_ps(i,ni,active);
+            n=_mm256_sub_epi32(n,_mm256_castps_si256(active));
+        }
+        _mm256_storeu_ps(buffer[0],r);
+        _mm256_storeu_ps(buffer[1],i);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(it+k),n);
+        for(qint32 l=0;l<LANES;++l)
+        {
+            zr[k+l]=buffer[0][l];
+            zi[k+l]=buffer[1][l];
+        }
+    }
+    quadraticFloatScalar(zr+k,zi+k,cr+k,ci+k,it+k,count-k,nIt,limit);
+}
+
+__attribute__((target("avx512f")))
+void quadraticFloatAvx512(double* zr,double* zi,const double* cr,const double* ci,qint32* it,qint32 count,qint32 nIt,double limit)
+{
+    const qint32 LANES=16;
+    qint32 k=0;
+    const __m512 lim=_mm512_set1_ps((float)limit);
+    const __m512i one=_mm512_set1_epi32(1);
+    float buffer[4][LANES];
+    for(;k+LANES<=count;k+=LANES)
+    {
+        for(qint32 l=0;l<LANES;++l)
+        {
+            buffer[0][l]=(float)zr[k+l];
+            buffer[1][l]=(float)zi[k+l];
+            buffer[2][l]=(float)cr[k+l];
+            buffer[3][l]=(float)ci[k+l];
+        }
+        __m512 r=_mm512_loadu_ps(buffer[0]),i=_mm512_loadu_ps(buffer[1]);
+        const __m512 cRe=_mm512_loadu_ps(buffer[2]),cIm=_mm512_loadu_ps(buffer[3]);
+        __m512i n=_mm512_setzero_si512();
+        for(qint32 step=0;step<nIt;++step)
+        {
+            __m512 rr=_mm512_mul_ps(r,r),ii=_mm512_mul_ps(i,i);
+            __mmask16 active=_mm512_cmp_ps_mask(_mm512_add_ps(rr,ii),lim,_CMP_LE_OQ);
+            if(!active)
+                break;
+            __m512 ri=_mm512_mul_ps(r,i);
+            r=_mm512_mask_add_ps(r,active,_mm512_sub_ps(rr,ii),cRe);
+            i=_mm512_mask_add_ps(i,active,_mm512_add_ps(ri,ri),cIm);
+            n=_mm512_mask_add_epi32(n,active,n,one);
+        }
+        _mm512_storeu_ps(buffer[0],r);
+        _mm512_storeu_ps(buffer[1],i);
+        _mm512_storeu_si512(it+k,n);
+        for(qint32 l=0;l<LANES;++l)
+        {
+            zr[k+l]=buffer[0][l];
+            zi[k+l]=buffer[1][l];
+        }
+    }
+    quadraticFloatScalar(zr+k,zi+k,cr+k,ci+k,it+k,count-k,nIt,limit);
+}
+
+#endif
+
+}
+
+BatchEscapeKernel selectQuadraticBatchKernel()
+{
+#ifdef MANDELBROT_X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return &quadraticAvx512;
+    if(__builtin_cpu_supports("avx2"))
+        return &quadraticAvx2;
+#endif
+    return &quadraticScalar;
+}
+
+BatchEscapeKernel selectQuadraticFloatBatchKernel()
+{
+#ifdef MANDELBROT_X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return &quadraticFloatAvx512;
+    if(__builtin_cpu_supports("avx2"))
+        return &quadraticFloatAvx2;
+#endif
+    return &quadraticFloatScalar;
+}
+
+const char* quadraticBatchKernelName()
+{
+#ifdef MANDELBROT_X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return "AVX-512";
+    if(__builtin_cpu_supports("avx2"))
+        return "AVX2";
+#endif
+    return "scalar";
+}
@@ -0,0 +1,21 @@
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <QtGlobal>
+
+//Vectorized escape time kernels for the quadratic formula z^2+c. A row of points is iterated 4 (AVX2) or 8 (AVX-512)
+//lanes at a time, lanes whose point has escaped are masked off while the remaining lanes continue.
+//Single precision variants run twice as many lanes for overviews which don't need double precision.
+//The instruction set is picked at runtime, so the same binary runs on hosts without AVX.
+
+//iterates count points with starting values zr,zi and constants cr,ci, on return zr,zi hold the final values of z
+//and it the number of iterations, exactly as the scalar kernel would report them
+typedef void (*BatchEscapeKernel)(double* zr,double* zi,const double* cr,const double* ci,qint32* it,qint32 count,qint32 nIt,double limit);
+
+BatchEscapeKernel selectQuadraticBatchKernel();
+//the same iterating in single precision, z and c are still passed as doubles
+BatchEscapeKernel selectQuadraticFloatBatchKernel();
+//name of the instruction set used by selectQuadraticBatchKernel
+const char* quadraticBatchKernelName();
+
+#endif // SIMDKERNELS_H
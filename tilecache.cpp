@@ -0,0 +1,76 @@
+#include "tilecache.h"
+#include <cmath>
+
+const size_t TileCache::DEFAULT_BUDGET=256*1024*1024;
+//grid cells are anchored at multiples of 2^GRID_ANCHOR_BITS pixels, offsets within are rounded to 2^-GRID_PHASE_BITS pixels
+const qint32 GRID_ANCHOR_BITS=24;
+const qint32 GRID_PHASE_BITS=16;
+
+void TileCache::setBudget(size_t budget)
+{
+    budget_=budget;
+    evict();
+}
+
+const TileCache::Tile* TileCache::find(const Key &key)
+{
+    std::map<Key,Entry>::iterator entry=entries_.find(key);
+    if(entry==entries_.end())
+        return 0;
+    uses_.splice(uses_.begin(),uses_,entry->second.use);
+    return &entry->second.tile;
+}
+
+void TileCache::insert(const Key &key, const Tile &tile)
+{
+    std::map<Key,Entry>::iterator entry=entries_.find(key);
+    if(entry!=entries_.end())
+    {
+        bytes_-=entry->second.tile.bytes();
+        uses_.erase(entry->second.use);
+        entries_.erase(entry);
+    }
+    uses_.push_front(key);
+    Entry& inserted=entries_[key];
+    inserted.tile=tile;
+    inserted.use=uses_.begin();
+    bytes_+=tile.bytes();
+    evict();
+}
+
+void TileCache::clear()
+{
+    entries_.clear();
+    uses_.clear();
+    bytes_=0;
+}
+
+void TileCache::evict()
+{
+    while(bytes_>budget_ && !uses_.empty())
+    {
+        std::map<Key,Entry>::iterator entry=entries_.find(uses_.back());
+        bytes_-=entry->second.tile.bytes();
+        entries_.erase(entry);
+        uses_.pop_back();
+    }
+}
+
+//the center is split into an anchor, rounded to a power of two of about 2^GRID_ANCHOR_BITS pixels, and the offset
+//to it in pixels. the offset is small enough for doubles to keep its fraction, the phase of the grid.
+void TileCache::gridPosition(const BigFixed &center, const FloatExp &scale, qint32 size, QString &origin, qint64 &first)
+{
+    //scale.e-1 is the binary exponent ilogb would give
+    qint32 bits=-(scale.e-1+GRID_ANCHOR_BITS);
+    BigFixed anchor=center.truncated(bits);
+    double offset=(double)((center-anchor).toFloatExp()/scale);
+    qint64 whole=(qint64)std::floor(offset);
+    qint64 phase=(qint64)std::floor((offset-whole)*(1<<GRID_PHASE_BITS)+0.5);
+    if(phase==(1<<GRID_PHASE_BITS))
+    {
+        ++whole;
+        phase=0;
+    }
+    origin=anchor.toString(qMax(bits,0))+"+"+QString::number(phase);
+    first=whole-size/2;
+}
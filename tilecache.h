@@ -0,0 +1,65 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QString>
+#include "bigfixed.h"
+#include <vector>
+#include <list>
+#include <map>
+
+//Cache of the iteration state of rendered tiles, so views rendered before don't have to be iterated again.
+//Tiles lie on a pixel grid shared by all views of the same scale which are offset by whole pixels, see gridPosition.
+//Least recently used tiles are dropped once the cache exceeds its memory budget.
+
+class TileCache
+{
+public:
+    //view identifies formula, parameters, scale and grid, x,y is the position of the tile on the grid in tiles
+    struct Key
+    {
+        QString view;
+        qint64 x,y;
+        bool operator<(const Key& other) const
+        {
+            if(x!=other.x)
+                return x<other.x;
+            if(y!=other.y)
+                return y<other.y;
+            return view<other.view;
+        }
+    };
+    //iteration state of the pixels of a tile in row order, as in IterationBuffer
+    struct Tile
+    {
+        std::vector<double> zr,zi;
+        std::vector<qint32> it;
+        std::vector<quint8> status;
+        size_t bytes() const {return it.size()*(2*sizeof(double)+sizeof(qint32)+sizeof(quint8));}
+    };
+    static const size_t DEFAULT_BUDGET;
+    explicit TileCache(size_t budget=DEFAULT_BUDGET): budget_(budget), bytes_(0) {}
+    void setBudget(size_t budget);
+    size_t bytes() const {return bytes_;}
+    //tile stored under the key or 0 if there is none, marks it as most recently used
+    const Tile* find(const Key& key);
+    void insert(const Key& key,const Tile& tile);
+    void clear();
+    //grid position of a view along one axis: origin identifies the grid, first is the grid index of the view's pixel 0.
+    //views share a grid if their centers are a whole number of pixels apart and lie within the same 2^24 pixels.
+    static void gridPosition(const BigFixed& center,const FloatExp& scale,qint32 size,QString& origin,qint64& first);
+private:
+    typedef std::list<Key> UseList;
+    struct Entry
+    {
+        Tile tile;
+        UseList::iterator use;
+    };
+    void evict();
+    std::map<Key,Entry> entries_;
+    //keys from most to least recently used
+    UseList uses_;
+    size_t budget_;
+    size_t bytes_;
+};
+
+#endif // TILECACHE_H
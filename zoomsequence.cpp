@@ -0,0 +1,223 @@
+#include "zoomsequence.h"
+#include "exponentialmap.h"
+#include "posterrenderer.h"
+#include <QThread>
+#include <QtMath>
+#include <cmath>
+#include <cstring>
+
+class ZoomSequence::FrameWriter : public QRunnable
+{
+public:
+    FrameWriter(ZoomSequence* sequence,const QString& fileName): sequence_(sequence), fileName_(fileName) {}
+    void run()
+    {
+        if(sequence_->cancel_.load() || sequence_->writeFailed_.load())
+            return;
+        if(frame().save(fileName_,"PNG"))
+            sequence_->framesWritten_.fetchAndAddOrdered(1);
+        else
+            sequence_->writeFailed_.store(1);
+    }
+protected:
+    virtual QImage frame() const=0;
+private:
+    ZoomSequence* sequence_;
+    QString fileName_;
+};
+
+class ZoomSequence::KeyframeWriter : public ZoomSequence::FrameWriter
+{
+public:
+    KeyframeWriter(ZoomSequence* sequence,const QImage& keyframe,qint32 width,qint32 height,double ratio,const QString& fileName):
+        FrameWriter(sequence,fileName), keyframe_(keyframe), width_(width), height_(height), ratio_(ratio) {}
+protected:
+    QImage frame() const {return resample(keyframe_,width_,height_,ratio_);}
+private:
+    QImage keyframe_;
+    qint32 width_,height_;
+    double ratio_;
+};
+
+class ZoomSequence::StripWriter : public ZoomSequence::FrameWriter
+{
+public:
+    StripWriter(ZoomSequence* sequence,const ExponentialRemapper* remapper,const QImage& strip,qint32 firstRow,const FloatExp& radius,const FloatExp& scale,const QString& fileName):
+        FrameWriter(sequence,fileName), remapper_(remapper), strip_(strip), firstRow_(firstRow), radius_(radius), scale_(scale) {}
+protected:
+    QImage frame() const {return remapper_->remap(strip_,firstRow_,radius_,scale_);}
+private:
+    const ExponentialRemapper* remapper_;
+    QImage strip_;
+    qint32 firstRow_;
+    FloatExp radius_,scale_;
+};
+
+ZoomSequence::ZoomSequence(): QObject(), engine_(new MandelbrotSet), errorCode_(0), framesWritten_(0), writeFailed_(0), cancel_(0)
+{
+    qRegisterMetaType<ZoomSequenceRequest>("ZoomSequenceRequest");
+    engine_->setParent(this);
+    //keyframes are never rendered twice, pixels are carried over by the engine's zoom reuse instead
+    engine_->setTileCacheBudget(0);
+    framePool_.setMaxThreadCount(QThread::idealThreadCount());
+    //the engine runs synchronously inside render, so its signals are handled right away
+    QObject::connect(engine_,&MandelbrotSet::errorCodeOut,[this](qint32 errorCode){errorCode_=errorCode;});
+    QObject::connect(engine_,&MandelbrotSet::imageOut,[this](QImage image){image_=image;});
+}
+
+ZoomSequence::~ZoomSequence()
+{
+    cancel_.store(1);
+    framePool_.waitForDone();
+}
+
+void ZoomSequence::render(ZoomSequenceRequest request)
+{
+    cancel_.store(0);
+    framesWritten_.store(0);
+    writeFailed_.store(0);
+    const MandelbrotConfig& config=request.config;
+    engine_->parseFormula(config.formula);
+    engine_->setColorPalette(request.colorPalette);
+    engine_->parsePaletteXFormula(config.paletteFormulaX);
+    engine_->parsePaletteYFormula(config.paletteFormulaY);
+    engine_->setCol0Interior(config.col0interior);
+    engine_->setRow0Interior(config.row0interior);
+
+    qint32 result=request.exponential?renderStrip(request):renderKeyframes(request);
+    framePool_.waitForDone();
+    image_=QImage();
+    emit framesWritten(framesWritten_.load());
+    if(result==SEQUENCE_COMPLETE && writeFailed_.load())
+        result=SEQUENCE_WRITE_ERROR;
+    if(result==SEQUENCE_PARSE_ERROR)
+        emit errorCodeOut(errorCode_);
+    emit finished(result);
+}
+
+qint32 ZoomSequence::renderKeyframes(const ZoomSequenceRequest &request)
+{
+    const MandelbrotConfig& config=request.config;
+    //frame i is zoomed in by 2^(i*halvings) from the first, keyframe k has the scale of the first frame times 2^-k
+    double halvings=std::log(request.zoomFactor)/std::log(2.);
+    qint32 frame=0;
+    while(frame<request.frames)
+    {
+        //a tiny tolerance keeps frames which land on a keyframe's scale from rounding to the previous keyframe
+        qint32 k=(qint32)std::floor(frame*halvings+1e-9);
+        //keyframe k has twice the resolution of a frame of its scale and covers the frames up to the next one
+        FloatExp keyScale=qMax(config.scale*FloatExp::fromLog2(-k-1),MIN_SCALE);
+        RenderRequest keyRequest={config.centerX,config.centerY,2*request.width,2*request.height,keyScale,config.nIterations,config.limit,1,config.julia,config.juliaRe,config.juliaIm,false,engine_->generation()};
+        image_=QImage();
+        engine_->render(keyRequest);
+        //frames of the previous keyframe were written meanwhile
+        framePool_.waitForDone();
+        emit framesWritten(framesWritten_.load());
+        qint32 result=renderResult();
+        if(result!=SEQUENCE_COMPLETE)
+            return result;
+        for(;frame<request.frames && (qint32)std::floor(frame*halvings+1e-9)==k;++frame)
+        {
+            double ratio=std::pow(2.,1.-(frame*halvings-k));
+            framePool_.start(new KeyframeWriter(this,image_,request.width,request.height,qBound(1.,ratio,2.),frameFileName(request.fileNamePattern,frame)));
+        }
+    }
+    return SEQUENCE_COMPLETE;
+}
+
+qint32 ZoomSequence::renderStrip(const ZoomSequenceRequest &request)
+{
+    const MandelbrotConfig& config=request.config;
+    qint32 stripWidth=ExponentialRemapper::matchingStripWidth(request.width,request.height);
+    ExponentialRemapper remapper(stripWidth,request.width,request.height);
+    //row 0 of the strip runs through the corners of the first frame, the last row lies inside the center pixel of the last one
+    FloatExp radius=config.scale*(std::sqrt((double)request.width*request.width+(double)request.height*request.height)/2);
+    //frames deeper than MIN_SCALE repeat the last one that isn't
+    const FloatExp lastScale=qMax(frameScale(config.scale,request.zoomFactor,request.frames-1),MIN_SCALE);
+    qint32 rows=(qint32)std::ceil(remapper.lastRow(radius,lastScale))+2;
+    qint32 bandRows=PosterRenderer::bandHeight(stripWidth,rows,PosterRenderer::DEFAULT_MEMORY_BUDGET);
+    //the rows from windowFirst on which frames still to be written need
+    QImage window;
+    qint32 windowFirst=0;
+    qint32 frame=0;
+    for(qint32 done=0;done<rows;)
+    {
+        //bands are strips of their own whose first row continues the previous band
+        qint32 h=qMax(2,qMin(bandRows,rows-done));
+        RenderRequest bandRequest={config.centerX,config.centerY,stripWidth,h,radius*std::exp(-done*2*M_PI/stripWidth),config.nIterations,config.limit,1,config.julia,config.juliaRe,config.juliaIm,true,engine_->generation()};
+        image_=QImage();
+        engine_->render(bandRequest);
+        //frames of the previous band were written meanwhile
+        framePool_.waitForDone();
+        emit framesWritten(framesWritten_.load());
+        qint32 result=renderResult();
+        if(result!=SEQUENCE_COMPLETE)
+            return result;
+        FloatExp scale=qMax(frameScale(config.scale,request.zoomFactor,frame),MIN_SCALE);
+        qint32 keep=qBound(windowFirst,(qint32)std::floor(remapper.firstRow(radius,scale)),done);
+        QImage next(stripWidth,done+h-keep,QImage::Format_RGB32);
+        for(qint32 y=keep;y<done+h;++y)
+        {
+            const uchar* source=(y<done)?window.constScanLine(y-windowFirst):image_.constScanLine(y-done);
+            std::memcpy(next.scanLine(y-keep),source,stripWidth*sizeof(quint32));
+        }
+        window=next;
+        windowFirst=keep;
+        done+=h;
+        //a frame is complete once the rows around its center pixel are there
+        for(;frame<request.frames && remapper.lastRow(radius,scale)+1<done;++frame,scale=qMax(frameScale(config.scale,request.zoomFactor,frame),MIN_SCALE))
+            framePool_.start(new StripWriter(this,&remapper,window,windowFirst,radius,scale,frameFileName(request.fileNamePattern,frame)));
+    }
+    //the remapper is gone once this returns
+    framePool_.waitForDone();
+    return SEQUENCE_COMPLETE;
+}
+
+qint32 ZoomSequence::renderResult() const
+{
+    if(errorCode_)
+        return SEQUENCE_PARSE_ERROR;
+    if(writeFailed_.load())
+        return SEQUENCE_WRITE_ERROR;
+    if(cancel_.load() || image_.isNull())
+        return SEQUENCE_CANCELED;
+    return SEQUENCE_COMPLETE;
+}
+
+QImage ZoomSequence::resample(const QImage &keyframe, qint32 width, qint32 height, double ratio)
+{
+    //frame pixel x lies at keyframe pixel (x-width/2)*ratio+width, as both are centered the way the engine centers views.
+    //each frame pixel averages 4 bilinear taps spread over its footprint, which is at most 2x2 keyframe pixels.
+    QImage frame(width,height,QImage::Format_RGB32);
+    const qint32 keyWidth=keyframe.width(),keyHeight=keyframe.height();
+    const double offsets[2]={-0.25*ratio,0.25*ratio};
+    for(qint32 y=0;y<height;++y)
+    {
+        quint32* out=reinterpret_cast<quint32*>(frame.scanLine(y));
+        double v0=(y-height/2)*ratio+height;
+        for(qint32 x=0;x<width;++x)
+        {
+            double u0=(x-width/2)*ratio+width;
+            double r=0,g=0,b=0;
+            for(qint32 j=0;j<2;++j)
+                for(qint32 i=0;i<2;++i)
+                {
+                    double u=qBound(0.,u0+offsets[i],keyWidth-1.),v=qBound(0.,v0+offsets[j],keyHeight-1.);
+                    qint32 iu=qMin((qint32)u,keyWidth-2),iv=qMin((qint32)v,keyHeight-2);
+                    double fu=u-iu,fv=v-iv;
+                    const quint32* row0=reinterpret_cast<const quint32*>(keyframe.constScanLine(iv));
+                    const quint32* row1=reinterpret_cast<const quint32*>(keyframe.constScanLine(iv+1));
+                    quint32 c[4]={row0[iu],row0[iu+1],row1[iu],row1[iu+1]};
+                    double w[4]={(1-fu)*(1-fv),fu*(1-fv),(1-fu)*fv,fu*fv};
+                    for(qint32 n=0;n<4;++n)
+                    {
+                        r+=w[n]*qRed(c[n]);
+                        g+=w[n]*qGreen(c[n]);
+                        b+=w[n]*qBlue(c[n]);
+                    }
+                }
+            out[x]=qRgb(qRound(r/4),qRound(g/4),qRound(b/4));
+        }
+    }
+    return frame;
+}
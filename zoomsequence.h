@@ -0,0 +1,77 @@
+#ifndef ZOOMSEQUENCE_H
+#define ZOOMSEQUENCE_H
+
+#include <QObject>
+#include <QImage>
+#include <QString>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include "mandelbrotset.h"
+
+//Renders the frames of a zoom video into a numbered PNG sequence.
+//Only keyframes are rendered, one per halving of the scale, each at twice the frame size and resolution.
+//The frames between two keyframes are resampled from the first of them, so they never magnify it.
+//Consecutive keyframes are an integer zoom apart, so the engine keeps every fourth pixel of the previous one.
+//Frames are resampled and encoded on a pool of their own while the next keyframe renders.
+//Alternatively the whole zoom is rendered as one exponential map strip in bands, see ExponentialRemapper,
+//and every frame is remapped from the rows of the strip it covers.
+
+struct ZoomSequenceRequest
+{
+    //config.centerX and centerY are the zoom target, config.scale the scale of the first frame
+    MandelbrotConfig config;
+    QImage colorPalette;
+    qint32 width;
+    qint32 height;
+    qint32 frames;
+    //ratio of the scales of consecutive frames, greater than 1
+    double zoomFactor;
+    //frame i is written to fileNamePattern with %1 replaced by i
+    QString fileNamePattern;
+    //frames are remapped from an exponential map instead of resampled from keyframes
+    bool exponential;
+};
+
+Q_DECLARE_METATYPE(ZoomSequenceRequest)
+
+class ZoomSequence : public QObject
+{
+    Q_OBJECT
+public:
+    enum Results {SEQUENCE_COMPLETE=0,SEQUENCE_CANCELED=1,SEQUENCE_PARSE_ERROR=2,SEQUENCE_WRITE_ERROR=3};
+    ZoomSequence();
+    ~ZoomSequence();
+    void cancel() {cancel_.store(1);engine_->cancel();}
+    //frames resampled and encoded at the same time
+    void setFramesInFlight(qint32 n) {framePool_.setMaxThreadCount(n<1?1:n);}
+    static QString frameFileName(const QString& pattern,qint32 frame) {return pattern.arg(frame,5,10,QChar('0'));}
+    //scale of frame i, firstScale*zoomFactor^-i, which may lie far beyond the range of double
+    static FloatExp frameScale(const FloatExp& firstScale,double zoomFactor,qint32 frame) {return firstScale*FloatExp::fromLog2(-frame*std::log2(zoomFactor));}
+public slots:
+    void render(ZoomSequenceRequest request);
+    void setThreadCount(qint32 n) {engine_->setThreadCount(n);}
+signals:
+    void framesWritten(qint32 frames);
+    void errorCodeOut(qint32 errorCode);
+    void finished(qint32 result);
+private:
+    class FrameWriter;
+    class KeyframeWriter;
+    class StripWriter;
+    //both return a value of Results, frames may still be in flight
+    qint32 renderKeyframes(const ZoomSequenceRequest& request);
+    qint32 renderStrip(const ZoomSequenceRequest& request);
+    //result of the render just done by the engine
+    qint32 renderResult() const;
+    //downsamples the center of a keyframe, ratio is the frame's pixel size in keyframe pixels, between 1 and 2
+    static QImage resample(const QImage& keyframe,qint32 width,qint32 height,double ratio);
+    MandelbrotSet* engine_;
+    QImage image_;
+    qint32 errorCode_;
+    QThreadPool framePool_;
+    QAtomicInt framesWritten_;
+    QAtomicInt writeFailed_;
+    QAtomicInt cancel_;
+};
+
+#endif // ZOOMSEQUENCE_H